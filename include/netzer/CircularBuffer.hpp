@@ -0,0 +1,120 @@
+//  CircularBuffer.hpp
+//
+//  lock-free single-producer/single-consumer ring-buffer for trivially copyable elements
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace netzer
+{
+
+/*!
+ * fixed-capacity ring-buffer, safe for one producer- and one consumer-thread without locking.
+ *
+ * capacity is rounded up to a power of two. push/pop transfer ranges with at most two memcpys,
+ * indices of producer and consumer live on separate cache-lines.
+ * size(), capacity() and empty() may be called from any thread.
+ */
+template<typename T>
+class CircularBuffer
+{
+    static_assert(std::is_trivially_copyable_v<T>, "CircularBuffer requires trivially copyable elements");
+
+public:
+
+    explicit CircularBuffer(size_t capacity) :
+            m_capacity(std::bit_ceil(std::max<size_t>(capacity, 1))),
+            m_data(new T[m_capacity]){}
+
+    CircularBuffer(const CircularBuffer &) = delete;
+
+    CircularBuffer &operator=(const CircularBuffer &) = delete;
+
+    [[nodiscard]] size_t capacity() const{ return m_capacity; }
+
+    [[nodiscard]] size_t size() const
+    {
+        // load tail first, so the difference never underflows
+        size_t tail = m_tail.load(std::memory_order_acquire);
+        return m_head.load(std::memory_order_acquire) - tail;
+    }
+
+    [[nodiscard]] bool empty() const{ return !size(); }
+
+    /*!
+     * producer: return the number of elements that fit into the buffer
+     */
+    [[nodiscard]] size_t free_space()
+    {
+        m_cached_tail = m_tail.load(std::memory_order_acquire);
+        return m_capacity - (m_head.load(std::memory_order_relaxed) - m_cached_tail);
+    }
+
+    /*!
+     * producer: append up to num_elements, return the number of elements actually written
+     */
+    size_t push(const T *data, size_t num_elements)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+
+        // refresh the consumer's index only if the cached one indicates lack of space
+        if(m_capacity - (head - m_cached_tail) < num_elements){ m_cached_tail = m_tail.load(std::memory_order_acquire); }
+        num_elements = std::min(num_elements, m_capacity - (head - m_cached_tail));
+        if(!num_elements){ return 0; }
+
+        size_t index = head & (m_capacity - 1);
+        size_t first = std::min(num_elements, m_capacity - index);
+        std::memcpy(m_data.get() + index, data, first * sizeof(T));
+        std::memcpy(m_data.get(), data + first, (num_elements - first) * sizeof(T));
+        m_head.store(head + num_elements, std::memory_order_release);
+        return num_elements;
+    }
+
+    /*!
+     * consumer: remove up to num_elements into out, return the number of elements actually read
+     */
+    size_t pop(T *out, size_t num_elements)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+
+        if(m_cached_head - tail < num_elements){ m_cached_head = m_head.load(std::memory_order_acquire); }
+        num_elements = std::min(num_elements, m_cached_head - tail);
+        if(!num_elements){ return 0; }
+
+        size_t index = tail & (m_capacity - 1);
+        size_t first = std::min(num_elements, m_capacity - index);
+        std::memcpy(out, m_data.get() + index, first * sizeof(T));
+        std::memcpy(out + first, m_data.get(), (num_elements - first) * sizeof(T));
+        m_tail.store(tail + num_elements, std::memory_order_release);
+        return num_elements;
+    }
+
+    /*!
+     * consumer: discard all elements
+     */
+    void clear()
+    {
+        m_cached_head = m_head.load(std::memory_order_acquire);
+        m_tail.store(m_cached_head, std::memory_order_release);
+    }
+
+private:
+    const size_t m_capacity;
+    std::unique_ptr<T[]> m_data;
+
+    // written by the producer, with the producer's copy of the consumer's index
+    alignas(64) std::atomic<size_t> m_head{0};
+    size_t m_cached_tail = 0;
+
+    // written by the consumer, with the consumer's copy of the producer's index
+    alignas(64) std::atomic<size_t> m_tail{0};
+    size_t m_cached_head = 0;
+};
+
+}// namespace
@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <cstring>
 #include "define_class_ptr.hpp"
 
 namespace netzer
@@ -1,6 +1,7 @@
 
 #pragma once
 
+#include <coroutine>
 #include <map>
 #include <set>
 #include "Connection.hpp"
@@ -14,11 +15,111 @@ namespace netzer
 
 NETZER_DEFINE_CLASS_PTR(Serial)
 
+//! policies for a full receive-buffer
+enum class overflow_policy_t : uint8_t
+{
+    // discard incoming bytes that do not fit
+    DROP_NEWEST,
+
+    // stop reading from the device until there is space again, relying on its flow-control
+    PAUSE
+};
+
+/*!
+ * driver- and read-path tuning for a Serial.
+ *
+ * reads are asynchronous, so receive-latency is dominated by the driver.
+ * latency-mode (low_latency_profile()): the driver forwards bytes as they arrive,
+ * instead of batching them (ftdi-adapters hold data for up to 16ms by default), at the cost of more wakeups.
+ * throughput-mode (default): reads double in size while they fill up completely (e.g. 3Mbaud ~ 300kB/s)
+ * and shrink again when traffic gets sparse, so bulk-transfers need few handler-invocations.
+ * with VTIME 0, the driver signals readability only after VMIN bytes arrived,
+ * so VMIN > 1 stalls messages shorter than VMIN until more data arrives.
+ */
+struct serial_config_t
+{
+    // termios VMIN/VTIME (VTIME in tenths of a second)
+    uint8_t vmin = 1, vtime = 0;
+
+    // request ASYNC_LOW_LATENCY from the driver (linux, ignored where unsupported)
+    bool low_latency = false;
+
+    // bounds for the size of reads, equal values disable adaptation
+    size_t min_read_size = 512, max_read_size = 64 * (1 << 10);
+
+    /*!
+     * return a profile for minimum latency: driver low-latency mode, reads starting small
+     */
+    static serial_config_t low_latency_profile()
+    {
+        serial_config_t ret;
+        ret.low_latency = true;
+        ret.min_read_size = 64;
+        return ret;
+    }
+};
+
+//! receive-metrics for a Serial
+struct serial_stats_t
+{
+    // capacity of the receive-buffer and its maximum fill-level observed
+    size_t capacity = 0, high_water_mark = 0;
+
+    uint64_t num_bytes_received = 0, num_bytes_dropped = 0;
+
+    // bytes written and number of transfers (coalesced writes)
+    uint64_t num_bytes_sent = 0, num_transfers = 0;
+
+    // current size of reads, adapted to throughput
+    size_t read_size = 0;
+};
+
 class Serial : public netzer::Connection, public std::enable_shared_from_this<Serial>
 {
 
 public:
 
+    // default capacity of the receive-buffer in bytes
+    static constexpr size_t DEFAULT_RECEIVE_BUFFER_SIZE = 512 * (1 << 10);
+
+    // queued writes up to this size are copied into a single contiguous transfer
+    static constexpr size_t MAX_COALESCE_SIZE = 1024;
+
+    // write completion function, provides a success-flag and the number of bytes written
+    using write_cb_t = std::function<void(bool, size_t)>;
+
+    // fires for failed writes, with a description of the error
+    using write_error_cb_t = std::function<void(const SerialPtr &, const std::string &)>;
+
+    //! awaitable for async_read, resumes with the number of bytes read (0: device closed)
+    struct read_awaitable_t
+    {
+        Serial *serial;
+        void *buffer;
+        size_t num_bytes;
+        size_t result = 0;
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> handle);
+
+        [[nodiscard]] size_t await_resume() const noexcept { return result; }
+    };
+
+    //! awaitable for async_write, resumes with the number of bytes written (0: failure)
+    struct write_awaitable_t
+    {
+        Serial *serial;
+        std::vector<std::vector<uint8_t>> buffers;
+        size_t result = 0;
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle);
+
+        [[nodiscard]] size_t await_resume() const noexcept { return result; }
+    };
+
     static SerialPtr create(io_service_t &io, receive_cb_t cb = {});
 
     virtual ~Serial();
@@ -28,6 +129,9 @@ public:
 
     static std::map<std::string, SerialPtr> connected_devices();
 
+    /*!
+     * open a device. non-standard baud-rates are set via termios2 on linux.
+     */
     bool open(const std::string &the_name, int the_baudrate = 57600);
 
     bool open() override;
@@ -36,27 +140,90 @@ public:
 
     bool is_open() const override;
 
+    /*!
+     * read buffered bytes, without locking. reads must not happen concurrently from multiple threads.
+     */
     size_t read_bytes(void *buffer, size_t sz) override;
 
+    /*!
+     * queue bytes for writing (non-blocking), return the number of bytes queued
+     */
     size_t write_bytes(const void *buffer, size_t sz) override;
 
+    /*!
+     * queue a sequence of buffers for writing (non-blocking).
+     * writes are transmitted in order with one transfer in flight, pending small writes are coalesced.
+     * the completion-callback fires when done or failed.
+     */
+    void write_buffers(std::vector<std::vector<uint8_t>> buffers, write_cb_t cb = {});
+
+    /*!
+     * return the number of bytes queued or in flight
+     */
+    [[nodiscard]] size_t queued_bytes() const;
+
+    void set_write_error_cb(write_error_cb_t cb);
+
     size_t available() const override;
 
     std::string description() const override;
 
     void drain() override;
 
+    /*!
+     * set a callback for received bytes, invoked on the io-thread. bytes buffered meanwhile are flushed
+     * to a newly attached callback on the io-thread. read_bytes() must not be used while a callback is set.
+     */
     void set_receive_cb(receive_cb_t the_cb) override;
 
     void set_connect_cb(connection_cb_t cb) override;
 
     void set_disconnect_cb(connection_cb_t cb) override;
 
+    /*!
+     * return an awaitable, reading up to num_bytes into buffer, e.g. 'n = co_await serial->async_read(buf, sz);'.
+     * buffered data is returned immediately, otherwise resumes as soon as any data arrives.
+     * a pending read takes precedence over the receive-callback.
+     */
+    [[nodiscard]] read_awaitable_t async_read(void *buffer, size_t num_bytes);
+
+    /*!
+     * return an awaitable, writing all bytes in order with other writes
+     */
+    [[nodiscard]] write_awaitable_t async_write(std::vector<uint8_t> bytes);
+
+    [[nodiscard]] size_t receive_buffer_size() const;
+
+    /*!
+     * set the capacity of the receive-buffer, which holds data not consumed by a receive-callback.
+     * only possible while closed, returns false otherwise.
+     */
+    bool set_receive_buffer_size(size_t num_bytes);
+
+    [[nodiscard]] overflow_policy_t overflow_policy() const;
+
+    void set_overflow_policy(overflow_policy_t policy);
+
+    [[nodiscard]] serial_config_t config() const;
+
+    /*!
+     * set driver- and read-path tuning, applied immediately if open, otherwise on open
+     */
+    void set_config(const serial_config_t &config);
+
+    [[nodiscard]] serial_stats_t stats() const;
+
+    void reset_stats();
+
 private:
 
-    void async_read_bytes();
+    /*!
+     * resume reading, if it was paused by a full receive-buffer
+     */
+    void resume_reading();
 
-    void async_write_bytes(const void *buffer, size_t sz);
+
+    void async_read_bytes();
 
     Serial(io_service_t &io, receive_cb_t cb);
 
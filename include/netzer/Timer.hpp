@@ -3,10 +3,14 @@
 #pragma once
 
 #include <chrono>
+#include <coroutine>
+#include <cstdint>
 #include <vector>
 #include <functional>
 #include <algorithm>
 #include <memory>
+#include "histogram.hpp"
+#include "tsc_clock.hpp"
 
 // forward declare boost io_service
 namespace boost::asio{ class io_context; }
@@ -19,7 +23,11 @@ class Stopwatch
 {
 public:
 
-    Stopwatch();
+    /*!
+     * create a running Stopwatch. clock_source_t::TSC selects the timestamp-counter,
+     * cheaper to read than steady_clock. it falls back to steady_clock if unavailable.
+     */
+    explicit Stopwatch(clock_source_t clock_source = clock_source_t::STEADY);
 
     /*!
      * start the timer. has no effect, if the timer is already running.
@@ -37,7 +45,7 @@ public:
     [[nodiscard]] bool running() const;
 
     /*!
-     * return the total time (in seconds) measured, including all previous laps.
+     * return the total time (in seconds) measured, including all previous laps (O(1)).
      */
     [[nodiscard]] double time_elapsed() const;
 
@@ -57,6 +65,12 @@ public:
      */
     void new_lap();
 
+    /*!
+     * begin measurement of a new lap, recording the finished lap into provided histogram
+     * instead of keeping it. memory stays constant, suitable for long-running measurements.
+     */
+    void new_lap(histogram_t &histogram);
+
     /*!
      * return the values for all previously measured laps.
      */
@@ -64,8 +78,78 @@ public:
 
 private:
     bool m_running = false;
-    std::chrono::steady_clock::time_point m_start_time;
+    clock_source_t m_clock_source = clock_source_t::STEADY;
+
+    // start of the current measurement in nanoseconds
+    int64_t m_start_time = 0;
     std::vector<double> m_laps;
+
+    // accumulated time of all laps, excluding a running measurement
+    double m_elapsed = 0.0;
+};
+
+//! policies for fixed-rate timers missing one or more deadlines
+enum class missed_tick_policy_t : uint8_t
+{
+    // drop missed ticks and continue with the next deadline in the future
+    SKIP,
+
+    // fire once for each missed tick, back-to-back
+    CATCH_UP,
+
+    // fire once for all missed ticks, see Timer::elapsed_ticks()
+    COALESCE
+};
+
+//! metrics for a Timer
+struct timer_stats_t
+{
+    // number of callback-invocations
+    uint64_t num_ticks = 0;
+
+    // number of ticks dropped or coalesced by fixed-rate timers
+    uint64_t num_missed = 0;
+
+    // number of ticks after which the next deadline had already passed when the callback returned
+    uint64_t num_overruns = 0;
+
+    // delay of callback-invocations versus their deadlines, in seconds
+    double mean_jitter = 0.0, max_jitter = 0.0;
+};
+
+/*!
+ * timer-service based on a hierarchical timing-wheel, backing an arbitrary number of Timers
+ * with a single asio-timer. insert, cancel and re-arm are O(1), expirations are rounded to
+ * the closest tick, i.e. the configured resolution. timer-callbacks are invoked on the io_service's thread.
+ */
+class TimerService
+{
+public:
+
+    // default tick-resolution in seconds
+    static constexpr double DEFAULT_RESOLUTION = 0.001;
+
+    explicit TimerService(io_service_t &io, double resolution = DEFAULT_RESOLUTION);
+
+    TimerService(const TimerService&) = delete;
+
+    TimerService& operator=(const TimerService&) = delete;
+
+    ~TimerService();
+
+    /*!
+     * return the tick-resolution in seconds
+     */
+    [[nodiscard]] double resolution() const;
+
+    /*!
+     * return the number of scheduled timers
+     */
+    [[nodiscard]] size_t num_timers() const;
+
+private:
+    friend class Timer;
+    std::shared_ptr<struct TimerServiceImpl> m_impl;
 };
 
 class Timer
@@ -73,6 +157,22 @@ class Timer
 public:
     typedef std::function<void(void)> timer_cb_t;
 
+    //! awaitable for after() and next(), resumes with true on expiration and false when cancelled
+    struct awaitable_t
+    {
+        Timer *timer;
+
+        // negative: await the next expiration without re-arming
+        double secs;
+        bool expired = false;
+
+        [[nodiscard]] bool await_ready() const noexcept { return !timer->m_impl; }
+
+        void await_suspend(std::coroutine_handle<> handle);
+
+        [[nodiscard]] bool await_resume() const noexcept { return expired; }
+    };
+
     Timer() = default;
 
     Timer(const Timer&) = delete;
@@ -85,6 +185,12 @@ public:
 
     explicit Timer(io_service_t &io, timer_cb_t cb = timer_cb_t());
 
+    /*!
+     * create a timer scheduled by a TimerService, instead of a dedicated asio-timer.
+     * the service may be destroyed before its timers, which are then cancelled.
+     */
+    explicit Timer(TimerService &service, timer_cb_t cb = timer_cb_t());
+
     /*!
      * set expiration date from now in seconds
      */
@@ -120,6 +226,53 @@ public:
      */
     void set_callback(timer_cb_t cb = timer_cb_t());
 
+    /*!
+     * arm the timer and return an awaitable for its expiration, e.g. 'co_await timer.after(0.5);'.
+     * only one coroutine can await a timer, a previous one is resumed as cancelled.
+     * cancelling or destroying the timer resumes an awaiting coroutine via the io_service.
+     */
+    [[nodiscard]] awaitable_t after(double secs);
+
+    /*!
+     * return an awaitable for the next expiration of an already armed timer, e.g. a periodic one
+     */
+    [[nodiscard]] awaitable_t next();
+
+    /*!
+     * returns true if a periodic timer is scheduled at a fixed rate
+     */
+    [[nodiscard]] bool fixed_rate() const;
+
+    /*!
+     * sets if a periodic timer should be scheduled at a fixed rate (default: false).
+     *
+     * by default, the next period starts after the callback has returned, so callback-durations
+     * and wakeup-latencies accumulate as drift. at a fixed rate, deadlines are derived from
+     * the initial expiration instead, missed deadlines are handled according to the missed-tick-policy.
+     */
+    void set_fixed_rate(bool b = true, missed_tick_policy_t policy = missed_tick_policy_t::SKIP);
+
+    /*!
+     * return the policy for missed deadlines of fixed-rate timers
+     */
+    [[nodiscard]] missed_tick_policy_t missed_tick_policy() const;
+
+    /*!
+     * return the number of ticks covered by the current callback-invocation.
+     * always 1, unless missed ticks are coalesced.
+     */
+    [[nodiscard]] uint64_t elapsed_ticks() const;
+
+    /*!
+     * return metrics for jitter, missed ticks and overruns
+     */
+    [[nodiscard]] timer_stats_t stats() const;
+
+    /*!
+     * reset all metrics
+     */
+    void reset_stats();
+
 private:
     std::shared_ptr<struct timer_impl> m_impl;
 };
@@ -0,0 +1,58 @@
+//  coroutine.hpp
+//
+//  minimal coroutine-type to drive the awaitables of Timer, tcp_connection, Serial and udp_server
+
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+
+namespace netzer
+{
+
+/*!
+ * allocate memory for a coroutine-frame. released frames are cached per thread
+ * and reused for subsequent frames of similar size.
+ */
+void *allocate_frame(size_t num_bytes);
+
+/*!
+ * release memory for a coroutine-frame, allocated with allocate_frame
+ */
+void release_frame(void *ptr, size_t num_bytes);
+
+/*!
+ * fire-and-forget coroutine, started eagerly.
+ * the frame is released after completion, exceptions escaping the coroutine are swallowed.
+ *
+ * netzer::task_t echo(netzer::tcp_connection_ptr con)
+ * {
+ *     std::vector<uint8_t> buf(4096);
+ *
+ *     while(size_t n = co_await con->async_read(buf.data(), buf.size()))
+ *     {
+ *         co_await con->async_write({buf.begin(), buf.begin() + n});
+ *     }
+ * }
+ */
+struct task_t
+{
+    struct promise_type
+    {
+        task_t get_return_object() noexcept { return {}; }
+
+        std::suspend_never initial_suspend() noexcept { return {}; }
+
+        std::suspend_never final_suspend() noexcept { return {}; }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() noexcept {}
+
+        static void *operator new(size_t num_bytes) { return allocate_frame(num_bytes); }
+
+        static void operator delete(void *ptr, size_t num_bytes) { release_frame(ptr, num_bytes); }
+    };
+};
+
+}// namespace
@@ -0,0 +1,150 @@
+//  histogram.hpp
+//
+//  log-bucketed latency histogram with fixed memory-footprint and a scoped-timer to feed it
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace crocore
+{
+
+/*!
+ * HDR-style histogram for durations, recorded in nanoseconds.
+ *
+ * each power of two is split into 16 linear sub-buckets, so percentiles are exact within ~3%,
+ * covering 1ns up to ~73min. memory is fixed, recording a sample is O(1) without allocation.
+ * instances are plain values: record per thread, then merge for aggregated results.
+ */
+struct histogram_t
+{
+    // linear sub-buckets per power of two (log2)
+    static constexpr uint32_t sub_bucket_bits = 4;
+
+    // largest recordable value, larger samples are clamped (log2)
+    static constexpr uint32_t max_value_bits = 42;
+
+    static constexpr size_t num_sub_buckets = size_t(1) << sub_bucket_bits;
+    static constexpr size_t num_buckets = (max_value_bits - sub_bucket_bits + 1) * num_sub_buckets;
+
+    std::array<uint64_t, num_buckets> buckets = {};
+    uint64_t count = 0;
+
+    // sum, minimum and maximum of all samples in nanoseconds
+    uint64_t sum = 0, min = 0, max = 0;
+
+    /*!
+     * return the bucket-index for a value
+     */
+    static constexpr size_t bucket_index(uint64_t value)
+    {
+        if(value < num_sub_buckets){ return value; }
+        value = std::min<uint64_t>(value, (uint64_t(1) << max_value_bits) - 1);
+        auto exponent = static_cast<uint32_t>(std::bit_width(value)) - 1;
+        auto sub_bucket = (value >> (exponent - sub_bucket_bits)) & (num_sub_buckets - 1);
+        return (exponent - sub_bucket_bits + 1) * num_sub_buckets + sub_bucket;
+    }
+
+    /*!
+     * return the smallest value mapping to a bucket
+     */
+    static constexpr uint64_t bucket_lower_bound(size_t index)
+    {
+        if(index < num_sub_buckets){ return index; }
+        auto exponent = static_cast<uint32_t>(index / num_sub_buckets) + sub_bucket_bits - 1;
+        return (num_sub_buckets + index % num_sub_buckets) << (exponent - sub_bucket_bits);
+    }
+
+    /*!
+     * record a sample (in nanoseconds)
+     */
+    void record(uint64_t ns)
+    {
+        buckets[bucket_index(ns)]++;
+        min = count ? std::min(min, ns) : ns;
+        max = count ? std::max(max, ns) : ns;
+        sum += ns;
+        count++;
+    }
+
+    /*!
+     * record a sample (in seconds)
+     */
+    void add(double secs);
+
+    /*!
+     * add all samples of another histogram
+     */
+    void merge(const histogram_t &other);
+
+    /*!
+     * discard all samples
+     */
+    void reset();
+
+    /*!
+     * return the mean of all recorded samples (in seconds)
+     */
+    [[nodiscard]] double mean() const;
+
+    /*!
+     * return an estimate for the provided percentile (in range [0, 1]) in seconds
+     */
+    [[nodiscard]] double percentile(double p) const;
+
+    /*!
+     * return an estimate for the provided percentile (in range [0, 1]) in nanoseconds
+     */
+    [[nodiscard]] uint64_t value_at_percentile(double p) const;
+};
+
+/*!
+ * RAII-helper, recording its lifetime into a histogram, e.g.
+ *
+ * {
+ *     crocore::ScopedTimer t(handler_latencies);
+ *     handle(request);
+ * }
+ *
+ * a cheaper clock can be provided, e.g. 'crocore::ScopedTimer<crocore::tsc_clock>'.
+ */
+template<typename Clock = std::chrono::steady_clock>
+class ScopedTimer
+{
+public:
+
+    explicit ScopedTimer(histogram_t &histogram) :
+            m_histogram(&histogram),
+            m_start_time(Clock::now()){}
+
+    ScopedTimer(const ScopedTimer &) = delete;
+
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+    ~ScopedTimer(){ if(m_histogram){ m_histogram->record(elapsed_ns()); }}
+
+    /*!
+     * return the time (in nanoseconds) since construction
+     */
+    [[nodiscard]] uint64_t elapsed_ns() const
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - m_start_time).count());
+    }
+
+    /*!
+     * do not record anything on destruction, e.g. for failed operations
+     */
+    void dismiss(){ m_histogram = nullptr; }
+
+private:
+    histogram_t *m_histogram;
+    typename Clock::time_point m_start_time;
+};
+
+}// namespace
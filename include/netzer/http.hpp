@@ -10,8 +10,12 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <optional>
 #include <functional>
 #include <memory>
+#include "define_class_ptr.hpp"
+#include "histogram.hpp"
 
 namespace netzer::http
 {
@@ -23,16 +27,295 @@ struct connection_info_t
     uint64_t timeout = 0;
 };
     
+//! timing-breakdown for a transfer, all values in seconds
+struct timing_t
+{
+    // duration of name-resolution, tcp-connect and tls-handshake
+    double dns = 0.0, connect = 0.0, tls = 0.0;
+
+    // time from start until the first byte was received (time-to-first-byte)
+    double ttfb = 0.0;
+
+    // total time for the transfer
+    double total = 0.0;
+
+    // true, if an existing connection was reused
+    bool connection_reused = false;
+};
+
 struct response_t
 {
     connection_info_t connection;
     uint64_t status_code = 0;
+
+    // response headers, names are converted to lower-case
+    std::map<std::string, std::string> headers;
+
     std::vector<uint8_t> data;
     double duration = 0.0;
+
+    // timing-breakdown for the (last) transfer
+    timing_t timing;
 };
     
-using progress_cb_t = std::function<void(connection_info_t)>;
+using progress_cb_t = std::function<void(const connection_info_t &)>;
 using completion_cb_t = std::function<void(response_t&)>;
+using error_cb_t = std::function<void(const connection_info_t &, const std::string &error)>;
+
+//! executor used to run completion- and error-handlers, e.g. by posting into an event-loop
+using executor_t = std::function<void(std::function<void()>)>;
+
+//! supported http-methods
+enum class method_t : uint8_t
+{
+    HEAD, GET, POST, PUT, DEL
+};
+
+//! scheduling priority for requests. queued requests with higher priority are dispatched first.
+enum class priority_t : uint8_t
+{
+    BULK = 0, NORMAL = 1, INTERACTIVE = 2
+};
+
+/*!
+ * policy for retrying failed requests with exponential backoff.
+ * only applies to idempotent methods (HEAD, GET, PUT, DELETE).
+ */
+struct retry_policy_t
+{
+    // maximum number of retries, 0 disables retries
+    uint32_t max_retries = 0;
+
+    // backoff (in seconds) before the first retry, multiplied for each subsequent retry
+    double backoff = 0.1;
+    double multiplier = 2.0;
+    double max_backoff = 10.0;
+
+    // randomized fraction of a backoff-interval, in range [0, 1]
+    double jitter = 0.5;
+
+    // also retry when receiving status 408, 429, 500, 502, 503 or 504
+    bool retry_status = true;
+
+    // honour Retry-After headers of 429/503 responses: the retry is delayed accordingly
+    // and further requests to the same host are held back (upper bound in seconds)
+    bool respect_retry_after = true;
+    double max_retry_after = 60.0;
+};
+
+/*!
+ * token-bucket rate-limit: requests are paced to a sustained rate, allowing short bursts.
+ * requests exceeding the limit are held back in the queue, not rejected.
+ */
+struct rate_limit_t
+{
+    // sustained rate in requests per second (0: unlimited)
+    double rate = 0.0;
+
+    // capacity of the bucket, i.e. number of requests that may be issued back-to-back
+    double burst = 1.0;
+};
+
+/*!
+ * policy for hedged requests: if a response takes longer than a percentile of recently
+ * observed latencies, a duplicate request is issued and the first response wins.
+ * only applies to idempotent methods (HEAD, GET, PUT, DELETE).
+ */
+struct hedge_policy_t
+{
+    bool enabled = false;
+
+    // percentile of recent latencies used as hedging-delay
+    double percentile = 0.95;
+
+    // bounds for the hedging-delay in seconds, max_delay is used until enough samples were collected
+    double min_delay = 0.005, max_delay = 1.0;
+};
+
+//! settings for content-encoding
+struct compression_policy_t
+{
+    // request gzip/deflate-encoded responses, decoded while streaming into the response-body
+    bool accept_encoding = false;
+
+    // gzip-compress request-bodies (POST, PUT) of at least this size in bytes, 0 disables compression
+    size_t request_threshold = 0;
+
+    // zlib compression-level [1 .. 9]
+    int level = 6;
+};
+
+//! metrics for content-encoding
+struct compression_stats_t
+{
+    // request-bodies: uncompressed size and size on the wire
+    uint64_t num_bytes_raw = 0, num_bytes_sent = 0;
+
+    // response-bodies: size on the wire and decoded size (tracked with accept_encoding enabled)
+    uint64_t num_bytes_received = 0, num_bytes_decoded = 0;
+
+    // time (in seconds) spent compressing request-bodies and decoding response-bodies
+    double encode_time = 0.0, decode_time = 0.0;
+
+    // compression-ratios (uncompressed / compressed)
+    double request_ratio = 0.0, response_ratio = 0.0;
+};
+
+//! generic description of a http request
+struct request_t
+{
+    method_t method = method_t::GET;
+    std::string url;
+
+    // payload and MIME-type, used for POST and PUT
+    std::vector<uint8_t> data;
+    std::string mime_type = "application/json";
+
+    priority_t priority = priority_t::NORMAL;
+
+    // optional overrides for the Client's retry- and hedging-policies
+    std::optional<retry_policy_t> retry;
+    std::optional<bool> hedge;
+};
+
+/*!
+ * an origin, for which connections are established ahead of requests and optionally kept warm.
+ * warm connections are picked up from the Client's connection-cache by subsequent requests.
+ *
+ * warm-ups are real HEAD-requests against the origin (libcurl does not reuse connect-only connections),
+ * so periodic re-warming is opt-in, to not put synthetic traffic on production endpoints.
+ */
+struct hot_origin_t
+{
+    // scheme, host and optional port, e.g. 'https://api.example.com'
+    std::string origin;
+
+    // number of connections to establish
+    uint32_t num_connections = 1;
+
+    // re-warm connections after being idle for this interval in seconds (0: warm only once)
+    double keep_warm_interval = 0.0;
+
+    // path used for warm-up requests (HEAD)
+    std::string path = "/";
+};
+
+//! metrics for a Client's request-queue
+struct queue_stats_t
+{
+    // number of requests waiting for a free connection-slot
+    size_t num_queued = 0;
+
+    // number of transfers currently in flight
+    size_t num_in_flight = 0;
+
+    // maximum number of queued requests observed
+    size_t max_queue_depth = 0;
+
+    // total number of requests dispatched from the queue
+    uint64_t num_dispatched = 0;
+
+    // total number of requests that were attached to an identical request in flight
+    uint64_t num_coalesced = 0;
+
+    // total number of retried requests and issued hedge-requests
+    uint64_t num_retries = 0, num_hedges = 0;
+
+    // total number of failed requests, after all retries
+    uint64_t num_errors = 0;
+
+    // total number of warm-up requests for hot origins
+    uint64_t num_warmups = 0;
+
+    // total number of dispatches held back by rate-limits or Retry-After
+    uint64_t num_throttled = 0;
+
+    // average and maximum time (in seconds) requests spent waiting in the queue
+    double mean_wait = 0.0, max_wait = 0.0;
+};
+
+//! metrics for a response-cache
+struct cache_stats_t
+{
+    // number of requests served from cache without contacting the server
+    uint64_t num_hits = 0;
+
+    // number of requests served from cache after a successful revalidation (304)
+    uint64_t num_revalidated = 0;
+
+    // number of requests that required a full transfer
+    uint64_t num_misses = 0;
+
+    // current number of entries and their accumulated size in bytes
+    size_t num_entries = 0, num_bytes = 0;
+
+    // ratio of requests that were answered with cached content
+    double hit_ratio = 0.0;
+};
+
+//! log-bucketed histogram for latencies, with fixed memory-footprint
+using latency_histogram_t = crocore::histogram_t;
+
+//! aggregated timings for all transfers to a host
+struct host_stats_t
+{
+    uint64_t num_requests = 0;
+    uint64_t num_reused_connections = 0;
+    latency_histogram_t dns, connect, tls, ttfb, total;
+};
+
+NETZER_DEFINE_CLASS_PTR(Cache)
+
+/*!
+ * in-memory LRU-cache for http responses.
+ *
+ * honours Cache-Control (max-age, no-cache, no-store) and Expires for freshness.
+ * stale entries are revalidated using If-None-Match/If-Modified-Since,
+ * a 304 (Not Modified) response is then answered from cache.
+ * a cache can be shared between Clients and the blocking helpers.
+ */
+class Cache
+{
+public:
+
+    // default budget for cached content
+    static constexpr size_t DEFAULT_MAX_BYTES = 64 * (1 << 20);
+
+    static CachePtr create(size_t max_bytes = DEFAULT_MAX_BYTES);
+
+    ~Cache();
+
+    Cache(const Cache &) = delete;
+
+    Cache &operator=(const Cache &) = delete;
+
+    /*!
+     * return the maximum number of bytes used for cached content
+     */
+    [[nodiscard]] size_t max_bytes() const;
+
+    /*!
+     * set the maximum number of bytes used for cached content, evicts least recently used entries
+     */
+    void set_max_bytes(size_t max_bytes);
+
+    /*!
+     * remove all entries
+     */
+    void clear();
+
+    /*!
+     * return metrics for this cache
+     */
+    [[nodiscard]] cache_stats_t stats() const;
+
+private:
+    friend class CurlAction;
+
+    explicit Cache(size_t max_bytes);
+
+    std::unique_ptr<struct CacheImpl> m_impl;
+};
 
 /*!
  * get the resource at the given url (blocking) with HTTP HEAD
@@ -40,9 +323,10 @@ using completion_cb_t = std::function<void(response_t&)>;
 response_t head(const std::string &url);
     
 /*!
- * get the resource at the given url (blocking) with HTTP GET
+ * get the resource at the given url (blocking) with HTTP GET.
+ * if a cache is provided, fresh content is served from it and stale content gets revalidated.
  */
-response_t get(const std::string &url);
+response_t get(const std::string &url, const CachePtr &cache = {});
 
 /*!
  * get the resource at the given url (blocking) with HTTP POST.
@@ -65,6 +349,86 @@ response_t put(const std::string &url,
  */
 response_t del(const std::string &url);
 
+//! options for parallel, ranged downloads
+struct download_options_t
+{
+    // number of concurrent transfers
+    uint32_t num_connections = 4;
+
+    // size of the byte-range requested per transfer
+    size_t chunk_size = 8 * (1 << 20);
+
+    // resume a previously interrupted download, if possible
+    bool resume = true;
+
+    // attempts per byte-range, before the download fails
+    uint32_t max_attempts = 3;
+
+    // connection timeout in ms (0: none)
+    uint64_t timeout = 0;
+};
+
+struct download_result_t
+{
+    bool success = false;
+
+    // size of the resource
+    uint64_t num_bytes = 0;
+
+    // bytes present from a previous attempt, not transferred again
+    uint64_t num_bytes_resumed = 0;
+
+    double duration = 0.0;
+    std::string error;
+};
+
+/*!
+ * download the resource at the given url into a file (blocking).
+ *
+ * the resource-size is queried with HEAD and the file is memory-mapped.
+ * if the server supports byte-ranges, the resource is split into chunks, fetched concurrently
+ * and written directly into their slot within the file.
+ * progress is tracked in a state-file (<path>.part) and an interrupted download can be resumed,
+ * if size and validator (ETag/Last-Modified) of the resource did not change.
+ * the progress-callback receives aggregated values for all transfers.
+ */
+download_result_t download(const std::string &url,
+                           const std::string &path,
+                           const download_options_t &options = {},
+                           const progress_cb_t &progress_cb = {});
+
+//! options for batches of requests
+struct batch_options_t
+{
+    // limits for concurrent transfers (0: unlimited)
+    uint32_t max_connections = 16;
+    uint32_t max_host_connections = 0;
+
+    // overall deadline for the entire batch in seconds (0: none)
+    double deadline = 0.0;
+
+    // coalesce identical GET/HEAD requests, their callbacks are passed the same response (see Client)
+    bool coalesce = false;
+};
+
+//! callback for streamed batch-results, receives the index of the originating request
+using batch_cb_t = std::function<void(size_t index, response_t &response)>;
+
+/*!
+ * issue a batch of requests concurrently on a single multi-handle (blocking).
+ * returns the responses in order of the requests.
+ * failed requests and requests not finished before the deadline yield a response with status_code 0.
+ */
+std::vector<response_t> batch(const std::vector<request_t> &requests, const batch_options_t &options = {});
+
+/*!
+ * issue a batch of requests concurrently on a single multi-handle (blocking).
+ * responses are streamed to the callback as they complete, in order of completion.
+ * the callback is invoked exactly once per request, also for failed or unfinished requests (status_code 0).
+ */
+void batch(const std::vector<request_t> &requests, const batch_cb_t &callback,
+           const batch_options_t &options = {});
+
 class Client
 {
 public:
@@ -72,7 +436,21 @@ public:
     // Timeout interval for http requests
     static constexpr uint64_t DEFAULT_TIMEOUT = 0;
 
-    explicit Client();
+    // minimum interval between progress-reports for a transfer, in seconds
+    static constexpr double DEFAULT_PROGRESS_INTERVAL = 0.05;
+
+    // default limits for concurrent transfers (0: unlimited)
+    static constexpr uint32_t DEFAULT_MAX_CONNECTIONS = 0;
+    static constexpr uint32_t DEFAULT_MAX_HOST_CONNECTIONS = 0;
+
+    /*!
+     * create a Client with <num_shards> independent multi-handles.
+     * requests are assigned to shards by host, preserving connection-reuse.
+     * with an io-thread, each shard is driven by its own thread (see start_io_thread).
+     */
+    explicit Client(uint32_t num_shards = 1);
+
+    ~Client();
 
     Client(const Client &other) = delete;
     Client(Client &&other) noexcept = default;
@@ -87,7 +465,8 @@ public:
                     progress_cb_t progress_cb = {});
     
     /*!
-     * get the resource at the given url (non-blocking) with HTTP GET
+     * get the resource at the given url (non-blocking) with HTTP GET.
+     * identical GET/HEAD requests in flight may be coalesced into a single transfer (see set_coalesce_requests).
      */
     void async_get(const std::string &url,
                    completion_cb_t completion_cb = {},
@@ -116,6 +495,16 @@ public:
      */
     void async_del(const std::string &url,
                    completion_cb_t completion_cb = {});
+
+    /*!
+     * issue a generic http request (non-blocking).
+     * requests are queued and dispatched by priority, whenever connection-limits permit.
+     * the error-callback fires, if the transfer failed after all retries.
+     */
+    void async_request(const request_t &request,
+                       completion_cb_t completion_cb = {},
+                       progress_cb_t progress_cb = {},
+                       error_cb_t error_cb = {});
     
     /*!
      * return the currently applied timeout for connections
@@ -128,10 +517,178 @@ public:
     void set_timeout(uint64_t t);
 
     /*!
-     * manually poll
+     * return the minimum interval between progress-reports for a transfer, in seconds
+     */
+    [[nodiscard]] double progress_interval() const;
+
+    /*!
+     * set the minimum interval between progress-reports for a transfer (default: 50ms).
+     * reports are only issued for changed values, completed transfers are always reported.
+     */
+    void set_progress_interval(double secs);
+
+    /*!
+     * return the maximum number of concurrent transfers (0: unlimited)
+     */
+    [[nodiscard]] uint32_t max_connections() const;
+
+    /*!
+     * set the maximum number of concurrent transfers (0: unlimited).
+     * requests exceeding this limit are queued until a slot frees up.
+     */
+    void set_max_connections(uint32_t n);
+
+    /*!
+     * return the maximum number of concurrent transfers per host (0: unlimited)
+     */
+    [[nodiscard]] uint32_t max_host_connections() const;
+
+    /*!
+     * set the maximum number of concurrent transfers per host (0: unlimited)
+     */
+    void set_max_host_connections(uint32_t n);
+
+    /*!
+     * return the default retry-policy
+     */
+    [[nodiscard]] retry_policy_t retry_policy() const;
+
+    /*!
+     * set the default retry-policy, applied to all requests not providing their own
+     */
+    void set_retry_policy(const retry_policy_t &policy);
+
+    /*!
+     * return the hedging-policy
+     */
+    [[nodiscard]] hedge_policy_t hedge_policy() const;
+
+    /*!
+     * set the hedging-policy
+     */
+    void set_hedge_policy(const hedge_policy_t &policy);
+
+    /*!
+     * return the global rate-limit
+     */
+    [[nodiscard]] rate_limit_t rate_limit() const;
+
+    /*!
+     * set a global rate-limit for all requests (default: unlimited).
+     * with multiple shards, rate and burst are split evenly between them.
+     */
+    void set_rate_limit(const rate_limit_t &limit);
+
+    /*!
+     * return the rate-limit for a host, if any
+     */
+    [[nodiscard]] rate_limit_t host_rate_limit(const std::string &host) const;
+
+    /*!
+     * set a rate-limit for requests to a host, applied in addition to the global limit.
+     * a rate of 0 removes the limit.
+     */
+    void set_host_rate_limit(const std::string &host, const rate_limit_t &limit);
+
+    /*!
+     * return the response-cache used for GET requests, if any
+     */
+    [[nodiscard]] CachePtr cache() const;
+
+    /*!
+     * set a response-cache used for GET requests. pass an empty pointer to disable caching.
+     */
+    void set_cache(CachePtr cache);
+
+    /*!
+     * return true if identical GET/HEAD requests are coalesced
+     */
+    [[nodiscard]] bool coalesce_requests() const;
+
+    /*!
+     * set if identical GET/HEAD requests should be coalesced (default: false).
+     * all subscribers of a coalesced transfer are passed the same response-instance,
+     * so completion-handlers must neither modify nor move content out of it.
+     * retry- and hedging-policies of the first request apply to the shared transfer,
+     * per-request overrides of later subscribers are ignored.
+     */
+    void set_coalesce_requests(bool b);
+
+    /*!
+     * return settings for content-encoding
+     */
+    [[nodiscard]] compression_policy_t compression_policy() const;
+
+    /*!
+     * set options for content-encoding, i.e. compressed responses and request-bodies (default: disabled)
+     */
+    void set_compression_policy(const compression_policy_t &policy);
+
+    /*!
+     * return metrics for content-encoding
+     */
+    [[nodiscard]] compression_stats_t compression_stats() const;
+
+    /*!
+     * declare an origin as hot: DNS, TCP and TLS setup for the configured number of connections
+     * is done ahead of requests and repeated after idle-periods, using lightweight HEAD requests.
+     * replaces an existing entry for the same origin.
+     */
+    void add_hot_origin(const hot_origin_t &hot_origin);
+
+    /*!
+     * stop keeping connections to an origin warm
+     */
+    void remove_hot_origin(const std::string &origin);
+
+    /*!
+     * return all hot origins
+     */
+    [[nodiscard]] std::vector<hot_origin_t> hot_origins() const;
+
+    /*!
+     * return metrics for the request-queue
+     */
+    [[nodiscard]] queue_stats_t queue_stats() const;
+
+    /*!
+     * return aggregated timings for completed transfers, per host
+     */
+    [[nodiscard]] std::map<std::string, host_stats_t> host_stats() const;
+
+    /*!
+     * reset aggregated timings for all hosts
+     */
+    void reset_host_stats();
+
+    /*!
+     * return the number of shards
+     */
+    [[nodiscard]] uint32_t num_shards() const;
+
+    /*!
+     * manually poll. no-op while an io-thread is running.
      */
     void poll();
 
+    /*!
+     * start a dedicated io-thread per shard, driving all transfers for this Client.
+     * submissions are then passed wait-free to the io-thread and may be issued from any thread.
+     * completion- and error-handlers are run by the provided executor (default: on the io-thread),
+     * progress-handlers are always run on the io-thread.
+     */
+    void start_io_thread(executor_t executor = {});
+
+    /*!
+     * stop a running io-thread. pending transfers are resumed by subsequent calls to poll().
+     */
+    void stop_io_thread();
+
+    /*!
+     * return true, if an io-thread is running
+     */
+    [[nodiscard]] bool io_thread_running() const;
+
 private:
     std::unique_ptr<struct ClientImpl> m_impl;
 };
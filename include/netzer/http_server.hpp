@@ -0,0 +1,106 @@
+//  http_server.hpp
+//
+//  embedded HTTP/1.1 server, built on top of tcp_server/tcp_connection
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <memory>
+#include "networking.hpp"
+
+namespace netzer::http
+{
+
+/*!
+ * parsed http request. all views point into the connection's receive-buffer
+ * and are only valid during invocation of a request-handler.
+ */
+struct server_request_t
+{
+    std::string_view method, target, path, query, version;
+    std::vector<std::pair<std::string_view, std::string_view>> headers;
+    std::string_view body;
+
+    // connection should be kept open after responding
+    bool keep_alive = true;
+
+    /*!
+     * return the value for a header (case-insensitive), or an empty view
+     */
+    [[nodiscard]] std::string_view header(std::string_view name) const;
+};
+
+//! response, filled in by a request-handler
+struct server_response_t
+{
+    uint16_t status = 200;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::vector<uint8_t> body;
+};
+
+using request_handler_t = std::function<void(const server_request_t &, server_response_t &)>;
+
+//! metrics for a Server
+struct server_stats_t
+{
+    uint64_t num_connections = 0, num_requests = 0;
+    uint64_t num_bytes_received = 0, num_bytes_sent = 0;
+};
+
+/*!
+ * small embedded HTTP/1.1 server.
+ *
+ * requests are parsed incrementally without copying, supporting keep-alive and pipelining.
+ * responses are transmitted in order with gather-writes for header and body.
+ * request-bodies with chunked transfer-encoding are not supported (501).
+ */
+class Server
+{
+public:
+
+    // default limit for the size of request-bodies
+    static constexpr size_t DEFAULT_MAX_BODY_SIZE = 16 * (1 << 20);
+
+    explicit Server(io_service_t &io_service);
+
+    Server();
+
+    ~Server();
+
+    Server(Server &&other) noexcept;
+
+    Server(const Server &) = delete;
+
+    Server &operator=(Server other);
+
+    bool start_listen(uint16_t port);
+
+    void stop_listen();
+
+    [[nodiscard]] uint16_t listening_port() const;
+
+    /*!
+     * add a handler for requests with provided method and path.
+     * an empty method matches all methods, a path ending with '*' matches by prefix.
+     */
+    void add_route(const std::string &method, const std::string &path, request_handler_t handler);
+
+    /*!
+     * set a handler for requests not matching any route (default: 404)
+     */
+    void set_default_handler(request_handler_t handler);
+
+    [[nodiscard]] size_t max_body_size() const;
+
+    void set_max_body_size(size_t num_bytes);
+
+    [[nodiscard]] server_stats_t stats() const;
+
+private:
+    std::shared_ptr<struct ServerImpl> m_impl;
+};
+
+}// namespace
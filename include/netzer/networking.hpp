@@ -13,6 +13,7 @@
 
 #pragma once
 
+#include <coroutine>
 #include "Connection.hpp"
 
 // forward declare boost io_service
@@ -72,6 +73,27 @@ public:
 
     using receive_cb_t = std::function<void(std::vector<uint8_t>, const std::string &, uint16_t)>;
 
+    //! a received datagram, empty when listening stopped
+    struct datagram_t
+    {
+        std::vector<uint8_t> data;
+        std::string ip;
+        uint16_t port = 0;
+    };
+
+    //! awaitable for receive()
+    struct receive_awaitable_t
+    {
+        udp_server *server;
+        datagram_t result;
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> handle);
+
+        datagram_t await_resume() { return std::move(result); }
+    };
+
     explicit udp_server(io_service_t &io_service, receive_cb_t f = receive_cb_t());
 
     udp_server() = default;
@@ -92,6 +114,13 @@ public:
 
     [[nodiscard]] uint16_t listening_port() const;
 
+    /*!
+     * return an awaitable for the next datagram, e.g. 'auto datagram = co_await server.receive();'.
+     * a pending receive takes precedence over the receive-function.
+     * without any of both, datagrams are queued by the socket.
+     */
+    [[nodiscard]] receive_awaitable_t receive();
+
 private:
     std::shared_ptr<struct udp_server_impl> m_impl;
 };
@@ -133,6 +162,41 @@ public:
     // tcp receive function
     using tcp_receive_cb_t = std::function<void(tcp_connection_ptr, std::vector<uint8_t>)>;
 
+    // write completion function, provides a success-flag and the number of bytes written
+    using write_cb_t = std::function<void(bool, size_t)>;
+
+    // limit for data buffered between coroutine-reads, receiving pauses when exceeded
+    static constexpr size_t MAX_READ_BACKLOG = 1 << 20;
+
+    //! awaitable for async_read, resumes with the number of bytes read (0: connection closed)
+    struct read_awaitable_t
+    {
+        tcp_connection *connection;
+        void *buffer;
+        size_t num_bytes;
+        size_t result = 0;
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> handle);
+
+        [[nodiscard]] size_t await_resume() const noexcept { return result; }
+    };
+
+    //! awaitable for async_write, resumes with the number of bytes written (0: failure)
+    struct write_awaitable_t
+    {
+        tcp_connection *connection;
+        std::vector<std::vector<uint8_t>> buffers;
+        size_t result = 0;
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle);
+
+        [[nodiscard]] size_t await_resume() const noexcept { return result; }
+    };
+
     static tcp_connection_ptr create(io_service_t &io_service,
                                      const std::string &ip,
                                      uint16_t port,
@@ -154,6 +218,31 @@ public:
 
     size_t write_bytes(const void *data, size_t num_bytes) override;
 
+    /*!
+     * write a sequence of buffers with a single gather-write (non-blocking).
+     * writes are queued and transmitted in order, the completion-callback fires when done.
+     */
+    void write_buffers(std::vector<std::vector<uint8_t>> buffers, write_cb_t cb = {});
+
+    /*!
+     * return an awaitable, reading up to num_bytes into buffer, e.g. 'n = co_await con->async_read(buf, sz);'.
+     * resumes as soon as any data is available. receive-callbacks are still served.
+     * after a first async_read, data arriving between reads is buffered.
+     * with more than MAX_READ_BACKLOG bytes buffered, receiving pauses (also for receive-callbacks)
+     * until subsequent reads drained the backlog.
+     */
+    [[nodiscard]] read_awaitable_t async_read(void *buffer, size_t num_bytes);
+
+    /*!
+     * return an awaitable, writing bytes in order with other writes
+     */
+    [[nodiscard]] write_awaitable_t async_write(std::vector<uint8_t> bytes);
+
+    /*!
+     * return an awaitable, writing a sequence of buffers with a single gather-write
+     */
+    [[nodiscard]] write_awaitable_t async_write(std::vector<std::vector<uint8_t>> buffers);
+
     size_t available() const override;
 
     void drain() override;
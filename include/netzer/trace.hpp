@@ -0,0 +1,98 @@
+//  trace.hpp
+//
+//  lightweight trace-event recording, exported as Chrome/Perfetto JSON
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace netzer::trace
+{
+
+namespace detail
+{
+// checked inline by spans, so a disabled span costs a single relaxed load
+extern std::atomic<bool> g_enabled;
+
+// out-of-line recording-path for spans
+int64_t span_begin();
+
+void span_end(const char *name, int64_t start_ns);
+}
+
+/*!
+ * enable/disable recording at runtime (default: disabled).
+ * spans are only compiled into netzer's handlers with the cmake-option NETZER_TRACING,
+ * otherwise nothing is recorded and NETZER_TRACE_SPAN expands to nothing.
+ */
+void set_enabled(bool b);
+
+[[nodiscard]] inline bool enabled(){ return detail::g_enabled.load(std::memory_order_relaxed); }
+
+/*!
+ * set the capacity in events for each thread's ring-buffer (default: 32768).
+ * only affects buffers of threads recording their first event afterwards.
+ * when full, the oldest events of a thread are overwritten.
+ * buffers of exited threads are recycled by new threads, discarding their events.
+ */
+void set_buffer_size(size_t num_events);
+
+/*!
+ * name the calling thread, shown in trace-viewers
+ */
+void set_thread_name(const std::string &name);
+
+/*!
+ * record a complete span for the calling thread. name must be a string-literal (or outlive the trace).
+ * timestamps are nanoseconds from crocore::tsc_clock.
+ */
+void record(const char *name, int64_t start_ns, int64_t end_ns);
+
+/*!
+ * return all recorded events in Chrome trace-event JSON, loadable by chrome://tracing or ui.perfetto.dev
+ */
+[[nodiscard]] std::string dump_json();
+
+/*!
+ * write all recorded events to a file in Chrome trace-event JSON, return true on success
+ */
+bool dump_json(const std::string &path);
+
+/*!
+ * discard all recorded events
+ */
+void clear();
+
+//! RAII-helper recording a span for its lifetime, if recording is enabled
+class Span
+{
+public:
+
+    explicit Span(const char *name) :
+            m_name(enabled() ? name : nullptr),
+            m_start_ns(m_name ? detail::span_begin() : 0){}
+
+    Span(const Span &) = delete;
+
+    Span &operator=(const Span &) = delete;
+
+    ~Span(){ if(m_name){ detail::span_end(m_name, m_start_ns); }}
+
+private:
+    const char *m_name;
+    int64_t m_start_ns;
+};
+
+}// namespace
+
+#define NETZER_TRACE_CONCAT_IMPL(a, b) a##b
+#define NETZER_TRACE_CONCAT(a, b) NETZER_TRACE_CONCAT_IMPL(a, b)
+
+#if defined(NETZER_TRACING)
+#define NETZER_TRACE_SPAN(name) ::netzer::trace::Span NETZER_TRACE_CONCAT(netzer_trace_span_, __LINE__)(name)
+#else
+#define NETZER_TRACE_SPAN(name) ((void)0)
+#endif
@@ -0,0 +1,116 @@
+//  tsc_clock.hpp
+//
+//  clock reading the cpu's timestamp-counter, calibrated against std::chrono::steady_clock
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace crocore
+{
+
+//! clock-sources for time-measurement
+enum class clock_source_t : uint8_t
+{
+    STEADY, TSC
+};
+
+/*!
+ * std::chrono-compatible clock, reading the timestamp-counter (rdtsc, cntvct_el0 on arm64).
+ *
+ * ticks are converted to nanoseconds on the timeline of steady_clock, using a calibration taken
+ * on first use (~10ms). a read costs a few cycles instead of a vDSO-call.
+ * without an invariant counter (cpuid) all reads fall back to steady_clock.
+ */
+struct tsc_clock
+{
+    using rep = int64_t;
+    using period = std::nano;
+    using duration = std::chrono::nanoseconds;
+    using time_point = std::chrono::time_point<tsc_clock>;
+    static constexpr bool is_steady = true;
+
+    //! linear mapping from counter-ticks to nanoseconds
+    struct calibration_t
+    {
+        // counter is invariant and was calibrated successfully
+        bool invariant = false;
+
+        // reference point in ticks and steady_clock-nanoseconds
+        uint64_t base_ticks = 0;
+        int64_t base_ns = 0;
+
+        double ticks_per_second = 0.0, ns_per_tick = 0.0;
+    };
+
+    /*!
+     * return the raw value of the timestamp-counter, 0 if unsupported
+     */
+    static uint64_t ticks() noexcept
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        uint64_t ret;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(ret));
+        return ret;
+#else
+        return 0;
+#endif
+    }
+
+    /*!
+     * return the calibration, taken once on first use
+     */
+    static const calibration_t &calibration()
+    {
+        static const calibration_t ret = calibrate();
+        return ret;
+    }
+
+    /*!
+     * return true, if reads are served by the timestamp-counter
+     */
+    static bool available(){ return calibration().invariant; }
+
+    /*!
+     * convert a raw counter-value to nanoseconds on the steady_clock-timeline
+     */
+    static int64_t to_nanoseconds(uint64_t ticks) noexcept
+    {
+        const auto &c = calibration();
+        auto delta = static_cast<double>(static_cast<int64_t>(ticks - c.base_ticks));
+        return c.base_ns + static_cast<int64_t>(delta * c.ns_per_tick);
+    }
+
+    static time_point now() noexcept
+    {
+        if(!calibration().invariant)
+        {
+            return time_point(std::chrono::duration_cast<duration>(
+                    std::chrono::steady_clock::now().time_since_epoch()));
+        }
+        return time_point(duration(to_nanoseconds(ticks())));
+    }
+
+    /*!
+     * convert a time_point to steady_clock
+     */
+    static std::chrono::steady_clock::time_point to_steady(time_point t)
+    {
+        return std::chrono::steady_clock::time_point(
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(t.time_since_epoch()));
+    }
+
+private:
+
+    //! detect an invariant counter and measure its frequency against steady_clock
+    static calibration_t calibrate();
+};
+
+}// namespace
@@ -0,0 +1,210 @@
+//  websocket.hpp
+//
+//  WebSocket (RFC 6455) client and server, built on top of tcp_connection/tcp_server
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include "define_class_ptr.hpp"
+#include "networking.hpp"
+
+namespace netzer::websocket
+{
+
+NETZER_DEFINE_CLASS_PTR(WebSocket)
+
+enum class opcode_t : uint8_t
+{
+    CONTINUATION = 0x0, TEXT = 0x1, BINARY = 0x2, CLOSE = 0x8, PING = 0x9, PONG = 0xA
+};
+
+//! status-codes for closing a connection (RFC 6455, 7.4.1)
+enum close_code_t : uint16_t
+{
+    CLOSE_NORMAL = 1000,
+    CLOSE_GOING_AWAY = 1001,
+    CLOSE_PROTOCOL_ERROR = 1002,
+    CLOSE_UNSUPPORTED_DATA = 1003,
+    CLOSE_NO_STATUS = 1005,
+    CLOSE_ABNORMAL = 1006,
+    CLOSE_INVALID_PAYLOAD = 1007,
+    CLOSE_POLICY_VIOLATION = 1008,
+    CLOSE_MESSAGE_TOO_BIG = 1009,
+    CLOSE_INTERNAL_ERROR = 1011
+};
+
+/*!
+ * a complete message, reassembled from fragments if necessary.
+ * the payload points into an internal buffer and is only valid during invocation of a message-callback.
+ */
+struct message_t
+{
+    opcode_t opcode = opcode_t::BINARY;
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+
+    [[nodiscard]] std::string_view text() const{ return {reinterpret_cast<const char *>(data), size}; }
+};
+
+//! metrics for a WebSocket
+struct stats_t
+{
+    uint64_t num_messages_received = 0, num_messages_sent = 0;
+    uint64_t num_frames_received = 0, num_frames_sent = 0;
+    uint64_t num_bytes_received = 0, num_bytes_sent = 0;
+};
+
+/*!
+ * WebSocket connection, either initiated as client or accepted by a Server.
+ *
+ * frames are parsed in place, unmasking is done in word-sized chunks.
+ * pings are answered automatically, fragmented messages are reassembled.
+ * text-messages with invalid UTF-8 fail the connection (CLOSE_INVALID_PAYLOAD),
+ * as do close-frames with a reserved status-code or an invalid reason (CLOSE_PROTOCOL_ERROR).
+ * all callbacks fire on the io_service's thread, sending, closing and setters are thread-safe.
+ */
+class WebSocket
+{
+public:
+
+    using open_cb_t = std::function<void(const WebSocketPtr &)>;
+    using message_cb_t = std::function<void(const WebSocketPtr &, const message_t &)>;
+    using pong_cb_t = std::function<void(const WebSocketPtr &, std::string_view payload)>;
+    using close_cb_t = std::function<void(const WebSocketPtr &, uint16_t code, std::string_view reason)>;
+
+    // default limit for the size of (reassembled) incoming messages
+    static constexpr size_t DEFAULT_MAX_MESSAGE_SIZE = 16 * (1 << 20);
+
+    // default time in seconds to wait for the peer's close-frame, before the connection is dropped
+    static constexpr double DEFAULT_CLOSE_TIMEOUT = 5.0;
+
+    /*!
+     * connect to a server, using an url like 'ws://host:port/path' (non-blocking).
+     * the open-callback fires after a successful handshake. 'wss' is not supported.
+     * returns an empty pointer for invalid urls.
+     */
+    static WebSocketPtr connect(io_service_t &io_service, const std::string &url, open_cb_t open_cb = {});
+
+    WebSocket(const WebSocket &) = delete;
+
+    WebSocket &operator=(const WebSocket &) = delete;
+
+    ~WebSocket();
+
+    /*!
+     * send a text-message
+     */
+    void send_text(std::string_view text);
+
+    /*!
+     * send a binary message
+     */
+    void send_binary(std::vector<uint8_t> data);
+
+    /*!
+     * send a ping, the pong-callback fires with the echoed payload (max. 125 bytes)
+     */
+    void ping(std::string_view payload = {});
+
+    /*!
+     * initiate the closing-handshake.
+     * the connection is dropped, if the peer does not answer within the close-timeout.
+     */
+    void close(uint16_t code = CLOSE_NORMAL, std::string_view reason = {});
+
+    /*!
+     * return true after a successful handshake, until the closing-handshake was initiated
+     */
+    [[nodiscard]] bool is_open() const;
+
+    void set_open_cb(open_cb_t cb);
+
+    void set_message_cb(message_cb_t cb);
+
+    void set_pong_cb(pong_cb_t cb);
+
+    void set_close_cb(close_cb_t cb);
+
+    [[nodiscard]] size_t max_message_size() const;
+
+    void set_max_message_size(size_t num_bytes);
+
+    /*!
+     * return the time in seconds to wait for the peer's close-frame after initiating the closing-handshake
+     */
+    [[nodiscard]] double close_timeout() const;
+
+    void set_close_timeout(double secs);
+
+    /*!
+     * return the maximum payload per frame, larger messages are sent fragmented (0: unlimited)
+     */
+    [[nodiscard]] size_t max_frame_size() const;
+
+    void set_max_frame_size(size_t num_bytes);
+
+    /*!
+     * return the request-path, as requested during handshake
+     */
+    [[nodiscard]] const std::string &path() const;
+
+    [[nodiscard]] stats_t stats() const;
+
+    [[nodiscard]] tcp_connection_ptr connection() const;
+
+private:
+    friend struct WebSocketImpl;
+    friend struct ServerImpl;
+    std::shared_ptr<struct WebSocketImpl> m_impl;
+
+    WebSocket() = default;
+};
+
+/*!
+ * WebSocket server, accepting upgrade-requests on a tcp_server
+ */
+class Server
+{
+public:
+
+    // fires for each connection after a successful handshake
+    using connection_cb_t = std::function<void(const WebSocketPtr &)>;
+
+    explicit Server(io_service_t &io_service, connection_cb_t cb = {});
+
+    Server();
+
+    ~Server();
+
+    Server(Server &&other) noexcept;
+
+    Server(const Server &) = delete;
+
+    Server &operator=(Server other);
+
+    bool start_listen(uint16_t port);
+
+    void stop_listen();
+
+    [[nodiscard]] uint16_t listening_port() const;
+
+    void set_connection_cb(connection_cb_t cb);
+
+    /*!
+     * return all open connections
+     */
+    [[nodiscard]] std::vector<WebSocketPtr> connections() const;
+
+    /*!
+     * send a text-message to all open connections
+     */
+    void broadcast(std::string_view text);
+
+private:
+    std::shared_ptr<struct ServerImpl> m_impl;
+};
+
+}// namespace
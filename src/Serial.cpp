@@ -1,8 +1,39 @@
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <deque>
 #include <mutex>
 #include <utility>
 #include <boost/asio.hpp>
 #include <boost/asio/serial_port.hpp>
 #include "netzer/Serial.hpp"
+#include "netzer/CircularBuffer.hpp"
+#include "netzer/trace.hpp"
+
+#if !defined(_WIN32)
+#include <termios.h>
+#include <sys/ioctl.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/serial.h>
+#endif
+
+// termios2 (arbitrary baud-rates) is only declared by kernel-headers clashing with <termios.h>
+#if defined(__linux__) && defined(TCGETS2) && \
+    (defined(__x86_64__) || defined(__i386__) || defined(__aarch64__) || defined(__arm__))
+#define NETZER_SERIAL_TERMIOS2
+#ifndef BOTHER
+#define BOTHER 0010000
+#endif
+struct termios2
+{
+    tcflag_t c_iflag, c_oflag, c_cflag, c_lflag;
+    cc_t c_line;
+    cc_t c_cc[19];
+    speed_t c_ispeed, c_ospeed;
+};
+#endif
 
 namespace netzer
 {
@@ -10,6 +41,28 @@ namespace
 {
 std::mutex g_mutex;
 std::map<std::string, SerialWeakPtr> g_connected_devices;
+
+// number of consecutive reads below a quarter of the read-size, before it is halved
+constexpr uint32_t g_num_short_reads_shrink = 8;
+
+/*!
+ * set a baud-rate unknown to termios, return true on success
+ */
+bool set_custom_baudrate(int fd, int baud_rate)
+{
+#if defined(NETZER_SERIAL_TERMIOS2)
+    termios2 tio = {};
+    if(ioctl(fd, TCGETS2, &tio)){ return false; }
+    tio.c_cflag &= ~CBAUD;
+    tio.c_cflag |= BOTHER;
+    tio.c_ispeed = tio.c_ospeed = static_cast<speed_t>(baud_rate);
+    return !ioctl(fd, TCSETS2, &tio);
+#else
+    (void)fd;
+    (void)baud_rate;
+    return false;
+#endif
+}
 }
 
 struct SerialImpl
@@ -17,12 +70,130 @@ struct SerialImpl
     std::string m_device_name;
     boost::asio::serial_port m_serial_port;
     Serial::connection_cb_t m_connect_cb, m_disconnect_cb;
+    // guarded by m_mutex, copied before invocation
     Serial::receive_cb_t m_receive_cb;
-    std::vector<uint8_t> m_rec_buffer = std::vector<uint8_t>(512);
-//    CircularBuffer<uint8_t> m_buffer{512 * (1 << 10)};
-    std::vector<uint8_t> m_buffer = std::vector<uint8_t>(512 * (1 << 10));
+    std::vector<uint8_t> m_rec_buffer;
+
+    // guarded by m_mutex
+    serial_config_t m_config;
+
+    // adaptive size of reads, only changed by the read-path
+    std::atomic<size_t> m_read_size{0};
+    uint32_t m_num_short_reads = 0;
+
+    // received data, not consumed by a receive-callback.
+    // written by the read-handler, consumed lock-free by read_bytes
+    std::unique_ptr<CircularBuffer<uint8_t>> m_buffer =
+            std::make_unique<CircularBuffer<uint8_t>>(Serial::DEFAULT_RECEIVE_BUFFER_SIZE);
+    std::atomic<overflow_policy_t> m_overflow_policy{overflow_policy_t::DROP_NEWEST};
+
+    // set while reading is paused by a full buffer
+    std::atomic<bool> m_paused{false};
+
+    std::atomic<size_t> m_high_water_mark{0};
+    std::atomic<uint64_t> m_num_bytes_received{0}, m_num_bytes_dropped{0};
+
+    // guards the handover to a pending coroutine-read
     std::mutex m_mutex;
 
+    // pending writes, transmitted in order with at most one transfer in flight
+    struct write_op_t
+    {
+        std::vector<std::vector<uint8_t>> buffers;
+        Serial::write_cb_t cb;
+    };
+    std::deque<write_op_t> m_write_queue;
+    bool m_write_in_flight = false;
+    size_t m_queued_bytes = 0;
+    std::mutex m_write_mutex;
+    Serial::write_error_cb_t m_write_error_cb;
+
+    std::atomic<uint64_t> m_num_bytes_sent{0}, m_num_transfers{0};
+
+    // pending coroutine-read
+    Serial::read_awaitable_t *m_read_awaiter = nullptr;
+    std::coroutine_handle<> m_read_continuation;
+
+    /*!
+     * apply termios- and driver-settings to an open port, return true on success.
+     * ASYNC_LOW_LATENCY is a hint, unsupported devices (e.g. pseudo-terminals) are tolerated.
+     */
+    bool apply_config(const serial_config_t &config)
+    {
+#if !defined(_WIN32)
+        int fd = m_serial_port.native_handle();
+        termios tio = {};
+        if(tcgetattr(fd, &tio)){ return false; }
+        tio.c_cc[VMIN] = config.vmin;
+        tio.c_cc[VTIME] = config.vtime;
+        if(tcsetattr(fd, TCSANOW, &tio)){ return false; }
+#endif
+
+#if defined(__linux__) && defined(ASYNC_LOW_LATENCY)
+        serial_struct serial_info = {};
+
+        if(!ioctl(fd, TIOCGSERIAL, &serial_info) &&
+           config.low_latency != static_cast<bool>(serial_info.flags & ASYNC_LOW_LATENCY))
+        {
+            serial_info.flags ^= ASYNC_LOW_LATENCY;
+            ioctl(fd, TIOCSSERIAL, &serial_info);
+        }
+#endif
+        return true;
+    }
+
+    /*!
+     * adapt the read-size after a read: grow while reads fill up completely,
+     * shrink after a series of reads using less than a quarter
+     */
+    void adapt_read_size(size_t num_bytes, size_t max_bytes, size_t min_read_size, size_t max_read_size)
+    {
+        size_t read_size = m_read_size.load(std::memory_order_relaxed);
+
+        if(num_bytes == max_bytes && max_bytes == read_size)
+        {
+            m_read_size.store(std::min(read_size * 2, max_read_size), std::memory_order_relaxed);
+            m_num_short_reads = 0;
+        }
+        else if(num_bytes < read_size / 4)
+        {
+            if(++m_num_short_reads >= g_num_short_reads_shrink)
+            {
+                m_read_size.store(std::max(read_size / 2, min_read_size), std::memory_order_relaxed);
+                m_num_short_reads = 0;
+            }
+        }
+        else{ m_num_short_reads = 0; }
+    }
+
+    /*!
+     * producer: append received data to the buffer, applying the overflow-policy
+     */
+    void store(const uint8_t *data, size_t num_bytes)
+    {
+        size_t num_stored = m_buffer->push(data, num_bytes);
+        if(num_stored < num_bytes){ m_num_bytes_dropped += num_bytes - num_stored; }
+
+        size_t fill_level = m_buffer->size();
+        if(fill_level > m_high_water_mark.load(std::memory_order_relaxed))
+        {
+            m_high_water_mark.store(fill_level, std::memory_order_relaxed);
+        }
+    }
+
+    /*!
+     * pop all buffered bytes, followed by num_bytes from data. called on the io-thread with a lock held,
+     * so bytes buffered before a receive-callback was attached are delivered first.
+     */
+    std::vector<uint8_t> take_buffered(const uint8_t *data, size_t num_bytes)
+    {
+        std::vector<uint8_t> ret(m_buffer->size() + num_bytes);
+        size_t num_buffered = m_buffer->pop(ret.data(), ret.size() - num_bytes);
+        std::copy(data, data + num_bytes, ret.begin() + static_cast<std::ptrdiff_t>(num_buffered));
+        ret.resize(num_buffered + num_bytes);
+        return ret;
+    }
+
     SerialImpl(boost::asio::io_service &io, Serial::receive_cb_t rec_cb) :
             m_serial_port(io),
             m_receive_cb(std::move(rec_cb)){}
@@ -123,11 +294,30 @@ bool Serial::open(const std::string &the_name, int the_baudrate)
     try
     {
         m_impl->m_serial_port.open(the_name);
-        m_impl->m_serial_port.set_option(br);
         m_impl->m_serial_port.set_option(flow_control);
         m_impl->m_serial_port.set_option(parity);
         m_impl->m_serial_port.set_option(stop_bits);
         m_impl->m_serial_port.set_option(char_size);
+
+        serial_config_t config;
+        {
+            std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+            config = m_impl->m_config;
+        }
+        if(!m_impl->apply_config(config))
+        {
+            m_impl->m_serial_port.close();
+            return false;
+        }
+
+        // set last, subsequent termios-calls might not preserve a custom rate
+        try{ m_impl->m_serial_port.set_option(br); }
+        catch(boost::system::system_error &)
+        {
+            if(!set_custom_baudrate(m_impl->m_serial_port.native_handle(), the_baudrate)){ throw; }
+        }
+        m_impl->m_read_size = std::max<size_t>(config.min_read_size, 1);
+        m_impl->m_num_short_reads = 0;
         m_impl->m_device_name = the_name;
 
         std::lock_guard<std::mutex> lock(g_mutex);
@@ -136,7 +326,12 @@ bool Serial::open(const std::string &the_name, int the_baudrate)
         if(m_impl->m_connect_cb){ m_impl->m_connect_cb(shared_from_this()); }
         return true;
     }
-    catch(boost::system::system_error&){ return false; }
+    catch(boost::system::system_error&)
+    {
+        boost::system::error_code ec;
+        if(m_impl->m_serial_port.is_open()){ m_impl->m_serial_port.close(ec); }
+        return false;
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -161,13 +356,8 @@ bool Serial::is_open() const
 
 size_t Serial::read_bytes(void *buffer, size_t sz)
 {
-    std::unique_lock<std::mutex> lock(m_impl->m_mutex);
-    size_t num_bytes = std::min(m_impl->m_buffer.size(), sz);
-    std::copy(m_impl->m_buffer.begin(), m_impl->m_buffer.begin() + (int)num_bytes,
-              (uint8_t *) buffer);
-    auto tmp = std::vector<uint8_t>(m_impl->m_buffer.begin() + (int)num_bytes,
-                                    m_impl->m_buffer.end());
-    m_impl->m_buffer.assign(tmp.begin(), tmp.end());
+    size_t num_bytes = m_impl->m_buffer->pop(static_cast<uint8_t *>(buffer), sz);
+    if(num_bytes){ resume_reading(); }
     return num_bytes;
 }
 
@@ -175,48 +365,228 @@ size_t Serial::read_bytes(void *buffer, size_t sz)
 
 size_t Serial::write_bytes(const void *buffer, size_t sz)
 {
-//        try{ return boost::asio::write(m_impl->m_serial_port, boost::asio::buffer(buffer, sz)); }
-//        catch(boost::system::system_error &e){ LOG_WARNING << e.what(); }
-    async_write_bytes(buffer, sz);
+    std::vector<std::vector<uint8_t>> buffers(1);
+    buffers.front().assign(static_cast<const uint8_t *>(buffer), static_cast<const uint8_t *>(buffer) + sz);
+    write_buffers(std::move(buffers));
     return sz;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
+/*!
+ * discard all queued writes, firing their completion-callbacks with failure
+ */
+static void fail_writes(SerialImpl &impl)
+{
+    std::deque<SerialImpl::write_op_t> ops;
+    {
+        std::unique_lock<std::mutex> lock(impl.m_write_mutex);
+        ops.swap(impl.m_write_queue);
+        impl.m_write_in_flight = false;
+        impl.m_queued_bytes = 0;
+    }
+    for(const auto &op: ops){ if(op.cb){ op.cb(false, 0); }}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ * start a single transfer for all queued writes. requires a lock on m_write_mutex.
+ * small buffers are copied into one contiguous block, larger ones are gathered as they are.
+ */
+static void write_queued(const std::shared_ptr<SerialImpl> &impl, const SerialWeakPtr &weak_self)
+{
+    if(impl->m_write_in_flight || impl->m_write_queue.empty()){ return; }
+    impl->m_write_in_flight = true;
+
+    auto ops = std::make_shared<std::vector<SerialImpl::write_op_t>>(
+            std::make_move_iterator(impl->m_write_queue.begin()), std::make_move_iterator(impl->m_write_queue.end()));
+    impl->m_write_queue.clear();
+
+    size_t num_coalesced = 0;
+    for(const auto &op: *ops)
+    {
+        for(const auto &b: op.buffers){ if(b.size() <= Serial::MAX_COALESCE_SIZE){ num_coalesced += b.size(); }}
+    }
+
+    // consecutive small buffers form a run within the coalesced block
+    auto coalesced = std::make_shared<std::vector<uint8_t>>();
+    coalesced->reserve(num_coalesced);
+    std::vector<boost::asio::const_buffer> buffers;
+    bool in_run = false;
+
+    for(const auto &op: *ops)
+    {
+        for(const auto &b: op.buffers)
+        {
+            if(b.empty()){ continue; }
+
+            if(b.size() <= Serial::MAX_COALESCE_SIZE)
+            {
+                if(!in_run){ buffers.emplace_back(coalesced->data() + coalesced->size(), 0); }
+                coalesced->insert(coalesced->end(), b.begin(), b.end());
+                buffers.back() = boost::asio::const_buffer(buffers.back().data(), buffers.back().size() + b.size());
+                in_run = true;
+            }
+            else
+            {
+                buffers.emplace_back(b.data(), b.size());
+                in_run = false;
+            }
+        }
+    }
+
+    boost::asio::async_write(impl->m_serial_port, buffers, [impl, weak_self, ops, coalesced]
+            (const boost::system::error_code &error, std::size_t bytes_transferred)
+    {
+        impl->m_num_transfers++;
+        impl->m_num_bytes_sent += bytes_transferred;
+        size_t num_bytes_total = 0;
+
+        for(const auto &op: *ops)
+        {
+            size_t num_bytes = 0;
+            for(const auto &b: op.buffers){ num_bytes += b.size(); }
+            num_bytes_total += num_bytes;
+            if(op.cb){ op.cb(!error, error ? 0 : num_bytes); }
+        }
+
+        if(!error)
+        {
+            std::unique_lock<std::mutex> lock(impl->m_write_mutex);
+            impl->m_queued_bytes -= num_bytes_total;
+            impl->m_write_in_flight = false;
+            write_queued(impl, weak_self);
+        }
+        else
+        {
+            fail_writes(*impl);
+
+            auto self = weak_self.lock();
+            if(self && impl->m_write_error_cb){ impl->m_write_error_cb(self, error.message()); }
+//            LOG_WARNING << error.message();
+        }
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Serial::write_buffers(std::vector<std::vector<uint8_t>> buffers, write_cb_t cb)
+{
+    size_t num_bytes = 0;
+    for(const auto &b: buffers){ num_bytes += b.size(); }
+
+    std::unique_lock<std::mutex> lock(m_impl->m_write_mutex);
+    m_impl->m_queued_bytes += num_bytes;
+    m_impl->m_write_queue.push_back({std::move(buffers), std::move(cb)});
+    write_queued(m_impl, weak_from_this());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t Serial::queued_bytes() const
+{
+    std::unique_lock<std::mutex> lock(m_impl->m_write_mutex);
+    return m_impl->m_queued_bytes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Serial::set_write_error_cb(write_error_cb_t cb)
+{
+    m_impl->m_write_error_cb = std::move(cb);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 void Serial::async_read_bytes()
 {
     auto weak_self = std::weak_ptr<Serial>(shared_from_this());
     auto impl_cp = m_impl;
 
-    m_impl->m_serial_port.async_read_some(boost::asio::buffer(m_impl->m_rec_buffer),
-                                          [weak_self, impl_cp](const boost::system::error_code &error,
-                                                               std::size_t bytes_transferred)
+    // no read in flight, the buffer can grow
+    size_t read_size = m_impl->m_read_size.load(std::memory_order_relaxed);
+    if(m_impl->m_rec_buffer.size() < read_size){ m_impl->m_rec_buffer.resize(read_size); }
+    size_t max_bytes = read_size;
+
+    bool has_receive_cb;
+    {
+        std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+        has_receive_cb = static_cast<bool>(m_impl->m_receive_cb);
+    }
+
+    // with PAUSE, only read what fits into the buffer
+    if(m_impl->m_overflow_policy == overflow_policy_t::PAUSE && !has_receive_cb)
+    {
+        max_bytes = std::min(max_bytes, m_impl->m_buffer->free_space());
+
+        if(!max_bytes)
+        {
+            // the consumer checks the flag after popping, re-check to not miss space freed meanwhile
+            m_impl->m_paused = true;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(!m_impl->m_buffer->free_space() || !m_impl->m_paused.exchange(false)){ return; }
+            max_bytes = std::min(read_size, m_impl->m_buffer->free_space());
+        }
+    }
+
+    m_impl->m_serial_port.async_read_some(boost::asio::buffer(m_impl->m_rec_buffer.data(), max_bytes),
+                                          [weak_self, impl_cp, max_bytes](const boost::system::error_code &error,
+                                                                          std::size_t bytes_transferred)
                                           {
+                                              NETZER_TRACE_SPAN("Serial::receive");
                                               auto self = weak_self.lock();
 
                                               if(!error)
                                               {
-                                                  if(bytes_transferred)
+                                                  std::coroutine_handle<> continuation;
+                                                  const uint8_t *data = impl_cp->m_rec_buffer.data();
+                                                  size_t num_bytes = bytes_transferred;
+                                                  impl_cp->m_num_bytes_received += num_bytes;
+
+                                                  if(num_bytes)
                                                   {
-                                                      if(self && impl_cp->m_receive_cb)
+                                                      std::unique_lock<std::mutex> lock(impl_cp->m_mutex);
+                                                      impl_cp->adapt_read_size(num_bytes, max_bytes,
+                                                                               impl_cp->m_config.min_read_size,
+                                                                               impl_cp->m_config.max_read_size);
+
+                                                      // a pending coroutine-read takes precedence
+                                                      if(impl_cp->m_read_awaiter)
                                                       {
-                                                          std::vector<uint8_t> datavec(impl_cp->m_rec_buffer.begin(),
-                                                                                       impl_cp->m_rec_buffer.begin() +
-                                                                                       bytes_transferred);
-                                                          impl_cp->m_receive_cb(self, datavec);
+                                                          auto *awaiter = std::exchange(impl_cp->m_read_awaiter, nullptr);
+                                                          continuation = std::exchange(impl_cp->m_read_continuation, {});
+                                                          awaiter->result = std::min(awaiter->num_bytes, num_bytes);
+                                                          std::copy(data, data + awaiter->result,
+                                                                    static_cast<uint8_t *>(awaiter->buffer));
+                                                          data += awaiter->result;
+                                                          num_bytes -= awaiter->result;
                                                       }
-                                                      else
+                                                      else if(self && impl_cp->m_receive_cb)
                                                       {
-                                                          std::unique_lock<std::mutex> lock(impl_cp->m_mutex);
-                                                          std::copy(impl_cp->m_rec_buffer.begin(),
-                                                                    impl_cp->m_rec_buffer.begin() + bytes_transferred,
-                                                                    std::back_inserter(impl_cp->m_buffer));
+                                                          auto receive_cb = impl_cp->m_receive_cb;
+                                                          auto bytes = impl_cp->take_buffered(data, num_bytes);
+                                                          lock.unlock();
+                                                          receive_cb(self, std::move(bytes));
+                                                          num_bytes = 0;
                                                       }
+                                                      // keep the remainder
+                                                      if(num_bytes){ impl_cp->store(data, num_bytes); }
                                                   }
                                                   if(self){ self->async_read_bytes(); }
+                                                  if(continuation){ continuation.resume(); }
                                               }
                                               else
                                               {
+                                                  // no more data for a pending read
+                                                  std::coroutine_handle<> continuation;
+                                                  {
+                                                      std::unique_lock<std::mutex> lock(impl_cp->m_mutex);
+                                                      impl_cp->m_read_awaiter = nullptr;
+                                                      continuation = std::exchange(impl_cp->m_read_continuation, {});
+                                                  }
+                                                  if(continuation){ continuation.resume(); }
+
                                                   switch(error.value())
                                                   {
                                                       case boost::asio::error::eof:
@@ -245,30 +615,72 @@ void Serial::async_read_bytes()
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void Serial::async_write_bytes(const void *buffer, size_t sz)
+void Serial::resume_reading()
 {
-    std::vector<uint8_t> bytes((uint8_t *) buffer, (uint8_t *) buffer + sz);
+    // pairs with the re-check in async_read_bytes
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(!m_impl->m_paused.load() || !m_impl->m_paused.exchange(false)){ return; }
 
-    boost::asio::async_write(m_impl->m_serial_port, boost::asio::buffer(bytes),
-                             [bytes](const boost::system::error_code & /*error*/,
-                                     std::size_t /*bytes_transferred*/)
-                             {
-//            if(error)
-//            {
-////                LOG_ERROR << error.message();
-//            }
-//            else if(bytes_transferred < bytes.size())
-//            {
-////                LOG_WARNING << "not all bytes written";
-//            }
-                             });
+    boost::asio::post(m_impl->m_serial_port.get_executor(), [weak_self = weak_from_this()]
+    {
+        auto self = weak_self.lock();
+        if(self && self->is_open()){ self->async_read_bytes(); }
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Serial::read_awaitable_t Serial::async_read(void *buffer, size_t num_bytes)
+{
+    return {this, buffer, num_bytes};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Serial::read_awaitable_t::await_suspend(std::coroutine_handle<> handle)
+{
+    auto &impl = *serial->m_impl;
+    std::unique_lock<std::mutex> lock(impl.m_mutex);
+
+    // buffered data or closed device -> resume immediately
+    if((result = impl.m_buffer->pop(static_cast<uint8_t *>(buffer), num_bytes)))
+    {
+        lock.unlock();
+        serial->resume_reading();
+        return false;
+    }
+    if(!impl.m_serial_port.is_open() || !num_bytes){ return false; }
+    impl.m_read_awaiter = this;
+    impl.m_read_continuation = handle;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Serial::write_awaitable_t Serial::async_write(std::vector<uint8_t> bytes)
+{
+    std::vector<std::vector<uint8_t>> buffers(1);
+    buffers.front() = std::move(bytes);
+    return {this, std::move(buffers)};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Serial::write_awaitable_t::await_suspend(std::coroutine_handle<> handle)
+{
+    // captures fit into std::function's local storage, no allocation
+    serial->write_buffers(std::move(buffers), [this, handle](bool success, size_t num_bytes)
+    {
+        result = success ? num_bytes : 0;
+        handle.resume();
+    });
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 size_t Serial::available() const
 {
-    return m_impl->m_buffer.size();
+    return m_impl->m_buffer->size();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -282,24 +694,41 @@ std::string Serial::description() const
 
 void Serial::drain()
 {
-//        m_impl->m_serial_port.cancel();
-    m_impl->m_buffer.clear();
-//        async_read_bytes();
+    m_impl->m_buffer->clear();
+    resume_reading();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 void Serial::set_receive_cb(receive_cb_t the_cb)
 {
-    m_impl->m_receive_cb = std::move(the_cb);
-
-    // we have some buffered data -> deliver it to the newly attached callback
-    if(m_impl->m_receive_cb && !m_impl->m_buffer.empty())
+    bool flush;
     {
         std::unique_lock<std::mutex> lock(m_impl->m_mutex);
-        m_impl->m_receive_cb(shared_from_this(), std::vector<uint8_t>(m_impl->m_buffer.begin(),
-                                                                      m_impl->m_buffer.end()));
-        m_impl->m_buffer.clear();
+        m_impl->m_receive_cb = std::move(the_cb);
+        flush = m_impl->m_receive_cb && !m_impl->m_buffer->empty();
+    }
+
+    // we have some buffered data -> deliver it to the newly attached callback.
+    // the buffer has a single consumer, so it is flushed on the io-thread instead of the caller's
+    if(flush)
+    {
+        boost::asio::post(m_impl->m_serial_port.get_executor(), [weak_self = weak_from_this()]
+        {
+            auto self = weak_self.lock();
+            if(!self){ return; }
+            auto &impl = *self->m_impl;
+            receive_cb_t receive_cb;
+            std::vector<uint8_t> bytes;
+            {
+                std::unique_lock<std::mutex> lock(impl.m_mutex);
+                if(!impl.m_receive_cb || impl.m_buffer->empty()){ return; }
+                receive_cb = impl.m_receive_cb;
+                bytes = impl.take_buffered(nullptr, 0);
+            }
+            receive_cb(self, std::move(bytes));
+            self->resume_reading();
+        });
     }
 }
 
@@ -317,5 +746,94 @@ void Serial::set_disconnect_cb(connection_cb_t the_cb)
     m_impl->m_disconnect_cb = std::move(the_cb);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+size_t Serial::receive_buffer_size() const
+{
+    return m_impl->m_buffer->capacity();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Serial::set_receive_buffer_size(size_t num_bytes)
+{
+    if(is_open()){ return false; }
+    m_impl->m_buffer = std::make_unique<CircularBuffer<uint8_t>>(num_bytes);
+    m_impl->m_high_water_mark = 0;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+overflow_policy_t Serial::overflow_policy() const
+{
+    return m_impl->m_overflow_policy;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Serial::set_overflow_policy(overflow_policy_t policy)
+{
+    m_impl->m_overflow_policy = policy;
+    if(policy != overflow_policy_t::PAUSE){ resume_reading(); }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+serial_config_t Serial::config() const
+{
+    std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_config;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Serial::set_config(const serial_config_t &config)
+{
+    serial_config_t sanitized = config;
+    sanitized.min_read_size = std::max<size_t>(sanitized.min_read_size, 1);
+    sanitized.max_read_size = std::max(sanitized.max_read_size, sanitized.min_read_size);
+    {
+        std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+        m_impl->m_config = sanitized;
+    }
+
+    if(is_open())
+    {
+        // the read-path clamps on its next adaptation, start from the new bounds right away
+        size_t read_size = m_impl->m_read_size.load(std::memory_order_relaxed);
+        m_impl->m_read_size.store(std::clamp(read_size, sanitized.min_read_size, sanitized.max_read_size),
+                                  std::memory_order_relaxed);
+        m_impl->apply_config(sanitized);
+    }
+    else{ m_impl->m_read_size = sanitized.min_read_size; }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+serial_stats_t Serial::stats() const
+{
+    serial_stats_t ret;
+    ret.capacity = m_impl->m_buffer->capacity();
+    ret.high_water_mark = m_impl->m_high_water_mark;
+    ret.num_bytes_received = m_impl->m_num_bytes_received;
+    ret.num_bytes_dropped = m_impl->m_num_bytes_dropped;
+    ret.num_bytes_sent = m_impl->m_num_bytes_sent;
+    ret.num_transfers = m_impl->m_num_transfers;
+    ret.read_size = m_impl->m_read_size;
+    return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Serial::reset_stats()
+{
+    m_impl->m_high_water_mark = m_impl->m_buffer->size();
+    m_impl->m_num_bytes_received = 0;
+    m_impl->m_num_bytes_dropped = 0;
+    m_impl->m_num_bytes_sent = 0;
+    m_impl->m_num_transfers = 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 }
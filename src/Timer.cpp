@@ -1,7 +1,14 @@
 
 
 #include "netzer/Timer.hpp"
+#include "netzer/trace.hpp"
 #include <utility>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <optional>
 #include <boost/asio.hpp>
 
 using std::chrono::duration_cast;
@@ -13,9 +20,20 @@ using duration_t = std::chrono::duration<double>;
 namespace crocore
 {
 
-Stopwatch::Stopwatch() :
+/*!
+ * return the current time in nanoseconds, read from provided clock-source
+ */
+static inline int64_t now_ns(clock_source_t clock_source)
+{
+    if(clock_source == clock_source_t::TSC){ return tsc_clock::now().time_since_epoch().count(); }
+    return duration_cast<std::chrono::nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+Stopwatch::Stopwatch(clock_source_t clock_source) :
         m_running(true),
-        m_start_time(steady_clock::now())
+        m_clock_source(clock_source),
+        m_start_time(now_ns(clock_source)),
+        m_laps(1, 0.0)
 {
 
 }
@@ -25,14 +43,17 @@ void Stopwatch::start()
     if(m_running){ return; }
 
     m_running = true;
-    m_start_time = steady_clock::now();
+    m_start_time = now_ns(m_clock_source);
+    if(m_laps.empty()){ m_laps.push_back(0.0); }
 }
 
 void Stopwatch::stop()
 {
     if(!m_running){ return; }
     m_running = false;
-    m_laps.back() += duration_cast<duration_t>(steady_clock::now() - m_start_time).count();
+    double lap_time = static_cast<double>(now_ns(m_clock_source) - m_start_time) / 1.0e9;
+    m_laps.back() += lap_time;
+    m_elapsed += lap_time;
 }
 
 bool Stopwatch::running() const
@@ -43,6 +64,7 @@ bool Stopwatch::running() const
 void Stopwatch::reset()
 {
     m_running = false;
+    m_elapsed = 0.0;
     m_laps.clear();
 }
 
@@ -50,30 +72,38 @@ void Stopwatch::new_lap()
 {
     if(!m_running){ return; }
 
-    m_laps.back() += duration_cast<duration_t>(steady_clock::now() - m_start_time).count();
-    m_start_time = steady_clock::now();
+    auto now = now_ns(m_clock_source);
+    double lap_time = static_cast<double>(now - m_start_time) / 1.0e9;
+    m_laps.back() += lap_time;
+    m_elapsed += lap_time;
+    m_start_time = now;
     m_laps.push_back(0.0);
 }
 
-double Stopwatch::time_elapsed() const
+void Stopwatch::new_lap(histogram_t &histogram)
 {
-    double ret = 0.0;
-
-    for(auto lap_time: m_laps){ ret += lap_time; }
+    if(!m_running){ return; }
 
-    if(!m_running){ return ret; }
+    auto now = now_ns(m_clock_source);
+    double lap_time = static_cast<double>(now - m_start_time) / 1.0e9;
+    histogram.add(m_laps.back() + lap_time);
+    m_elapsed += lap_time;
+    m_start_time = now;
+    m_laps.back() = 0.0;
+}
 
-    ret += duration_cast<duration_t>(steady_clock::now() - m_start_time).count();
-    return ret;
+double Stopwatch::time_elapsed() const
+{
+    if(!m_running){ return m_elapsed; }
+    return m_elapsed + static_cast<double>(now_ns(m_clock_source) - m_start_time) / 1.0e9;
 }
 
 double Stopwatch::time_elapsed_for_lap() const
 {
-    if(m_running)
-    {
-        return m_laps.back() + duration_cast<duration_t>(steady_clock::now() - m_start_time).count();
-    }
-    else{ return m_laps.back(); }
+    double lap_time = m_laps.empty() ? 0.0 : m_laps.back();
+
+    if(m_running){ return lap_time + static_cast<double>(now_ns(m_clock_source) - m_start_time) / 1.0e9; }
+    else{ return lap_time; }
 }
 
 const std::vector<double> &Stopwatch::laps() const
@@ -83,26 +113,468 @@ const std::vector<double> &Stopwatch::laps() const
 
 /////////////////////////////////////////////////////////////////////////
 
-struct timer_impl
+struct TimerServiceImpl;
+
+struct timer_impl : public std::enable_shared_from_this<timer_impl>
 {
-    boost::asio::basic_waitable_timer<std::chrono::steady_clock> m_timer;
+    // dedicated asio-timer, unused for timers scheduled by a TimerService
+    std::optional<boost::asio::basic_waitable_timer<std::chrono::steady_clock>> m_timer;
+
+    // timing-wheel and links within its slot, level -1 while not scheduled
+    std::shared_ptr<TimerServiceImpl> m_service;
+    timer_impl *m_prev = nullptr, *m_next = nullptr;
+    int m_level = -1;
+    uint64_t m_slot = 0;
+    uint64_t m_expiry_tick = 0;
+
+    // incremented on each (re-)arm and cancel, detects changes during callbacks
+    uint64_t m_generation = 0;
+
+    // period and absolute deadline of the next expiration
+    steady_clock::duration m_interval{};
+    steady_clock::time_point m_deadline;
+
+    // fixed-rate scheduling
+    bool m_fixed_rate = false;
+    missed_tick_policy_t m_missed_tick_policy = missed_tick_policy_t::SKIP;
+    uint64_t m_elapsed_ticks = 1;
+
+    timer_stats_t m_stats;
+    double m_total_jitter = 0.0;
+
+    // awaiting coroutine and its result
+    std::coroutine_handle<> m_continuation;
+    bool *m_continuation_result = nullptr;
+
     Timer::timer_cb_t m_callback;
     bool m_periodic;
     bool m_running;
 
     timer_impl(boost::asio::io_service &io, Timer::timer_cb_t cb) :
-            m_timer(io),
+            m_callback(std::move(cb)),
+            m_periodic(false),
+            m_running(false)
+    {
+        m_timer.emplace(io);
+    }
+
+    timer_impl(std::shared_ptr<TimerServiceImpl> service, Timer::timer_cb_t cb) :
+            m_service(std::move(service)),
             m_callback(std::move(cb)),
             m_periodic(false),
             m_running(false){}
 
-    ~timer_impl()
+    ~timer_impl();
+
+    /*!
+     * take an awaiting coroutine for resumption, marking its result
+     */
+    std::coroutine_handle<> take_continuation(bool expired)
+    {
+        if(m_continuation){ *m_continuation_result = expired; }
+        return std::exchange(m_continuation, {});
+    }
+
+    /*!
+     * resume a cancelled coroutine via the io_service, not from within cancel() or a destructor
+     */
+    void resume_cancelled(std::coroutine_handle<> handle);
+
+    /*!
+     * account for an expiration: update metrics and advance the deadline of fixed-rate timers
+     */
+    void on_expire(steady_clock::time_point now)
+    {
+        auto lateness = std::max(now - m_deadline, steady_clock::duration(0));
+        double jitter = duration_cast<duration_t>(lateness).count();
+        m_stats.num_ticks++;
+        m_total_jitter += jitter;
+        m_stats.mean_jitter = m_total_jitter / static_cast<double>(m_stats.num_ticks);
+        m_stats.max_jitter = std::max(m_stats.max_jitter, jitter);
+        m_elapsed_ticks = 1;
+
+        if(!m_fixed_rate || !m_periodic || m_interval <= steady_clock::duration(0)){ return; }
+
+        // deadlines passed since the scheduled one
+        auto num_elapsed = static_cast<uint64_t>(1 + lateness / m_interval);
+
+        switch(m_missed_tick_policy)
+        {
+            case missed_tick_policy_t::CATCH_UP:
+                m_deadline += m_interval;
+                break;
+
+            case missed_tick_policy_t::COALESCE:
+                m_elapsed_ticks = num_elapsed;
+                [[fallthrough]];
+
+            case missed_tick_policy_t::SKIP:
+                m_stats.num_missed += num_elapsed - 1;
+                m_deadline += static_cast<steady_clock::duration::rep>(num_elapsed) * m_interval;
+                break;
+        }
+    }
+
+    /*!
+     * prepare the deadline for the next period, after the callback has returned
+     */
+    void on_rearm(steady_clock::time_point now)
+    {
+        if(!m_fixed_rate){ m_deadline = now + m_interval; }
+        else if(now > m_deadline){ m_stats.num_overruns++; }
+    }
+
+    /*!
+     * arm the dedicated asio-timer for the current deadline
+     */
+    void arm()
+    {
+        m_generation++;
+        m_running = true;
+        m_timer->expires_at(m_deadline);
+
+        std::weak_ptr<timer_impl> weak_self = weak_from_this();
+        m_timer->async_wait([weak_self](const boost::system::error_code &error)
+                            {
+                                // Timer expired regularly
+                                auto self = weak_self.lock();
+                                if(!error && self){ self->expire(); }
+                            });
+    }
+
+    /*!
+     * expiration of the dedicated asio-timer
+     */
+    void expire()
+    {
+        NETZER_TRACE_SPAN("Timer::expire");
+        m_running = false;
+        on_expire(steady_clock::now());
+        auto generation = m_generation;
+        if(m_callback){ m_callback(); }
+
+        // re-arm periodic timers, unless changed by the callback
+        if(m_periodic && m_generation == generation)
+        {
+            on_rearm(steady_clock::now());
+            arm();
+        }
+
+        // last step, the coroutine might destroy this timer
+        if(auto handle = take_continuation(true)){ handle.resume(); }
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////
+
+struct TimerServiceImpl : public std::enable_shared_from_this<TimerServiceImpl>
+{
+    // 6 levels with 64 slots each, covering 2^36 ticks (~795 days at 1ms resolution)
+    static constexpr uint32_t num_levels = 6, slot_bits = 6;
+    static constexpr uint64_t num_slots = 1 << slot_bits, slot_mask = num_slots - 1;
+    static constexpr uint64_t range = uint64_t(1) << (slot_bits * num_levels);
+    static constexpr uint64_t no_tick = std::numeric_limits<uint64_t>::max();
+
+    boost::asio::basic_waitable_timer<std::chrono::steady_clock> m_timer;
+    steady_clock::duration m_resolution;
+    steady_clock::time_point m_start_time;
+
+    // current tick, timers up to and including it have been processed
+    uint64_t m_current = 0;
+
+    // tick the asio-timer is armed for
+    uint64_t m_armed_tick = no_tick;
+
+    // intrusive lists of timers per slot, bitmasks of non-empty slots per level
+    std::array<std::array<timer_impl *, num_slots>, num_levels> m_slots = {};
+    std::array<uint64_t, num_levels> m_occupied = {};
+    size_t m_num_timers = 0;
+
+    // set while expired timers are processed
+    bool m_advancing = false;
+    bool m_shutdown = false;
+
+    mutable std::mutex m_mutex;
+
+    TimerServiceImpl(boost::asio::io_service &io, double resolution) :
+            m_timer(io),
+            m_resolution(std::max<steady_clock::duration>(duration_cast<steady_clock::duration>(duration_t(resolution)),
+                                                          steady_clock::duration(1))),
+            m_start_time(steady_clock::now()){}
+
+    [[nodiscard]] uint64_t now_tick() const
+    {
+        return static_cast<uint64_t>((steady_clock::now() - m_start_time) / m_resolution);
+    }
+
+    /*!
+     * insert a timer into the wheel, according to the distance of its expiration. requires a lock.
+     */
+    void link(timer_impl *t)
+    {
+        // beyond the wheel's range -> park in the top level, re-evaluated when cascaded
+        uint64_t delta = t->m_expiry_tick - m_current;
+        uint64_t tick = delta < range ? t->m_expiry_tick : m_current + range - 1;
+        delta = tick - m_current;
+
+        auto level = delta ? std::min<uint32_t>((std::bit_width(delta) - 1) / slot_bits, num_levels - 1) : 0;
+        auto slot = (tick >> (slot_bits * level)) & slot_mask;
+        auto &head = m_slots[level][slot];
+
+        t->m_level = static_cast<int>(level);
+        t->m_slot = slot;
+        t->m_prev = nullptr;
+        t->m_next = head;
+        if(head){ head->m_prev = t; }
+        head = t;
+        m_occupied[level] |= uint64_t(1) << slot;
+        m_num_timers++;
+    }
+
+    /*!
+     * remove a timer from the wheel, if scheduled. requires a lock.
+     */
+    void unlink(timer_impl *t)
+    {
+        if(t->m_level < 0){ return; }
+        auto &head = m_slots[t->m_level][t->m_slot];
+
+        if(t->m_prev){ t->m_prev->m_next = t->m_next; }
+        else{ head = t->m_next; }
+        if(t->m_next){ t->m_next->m_prev = t->m_prev; }
+        if(!head){ m_occupied[t->m_level] &= ~(uint64_t(1) << t->m_slot); }
+
+        t->m_prev = t->m_next = nullptr;
+        t->m_level = -1;
+        m_num_timers--;
+    }
+
+    /*!
+     * (re-)arm a timer to expire at its deadline. requires a lock.
+     */
+    void schedule(timer_impl *t)
+    {
+        unlink(t);
+        t->m_generation++;
+        if(m_shutdown){ return; }
+
+        // idle wheel -> skip ahead, nothing to process in between
+        if(!m_num_timers && !m_advancing){ m_current = std::max(m_current, now_tick()); }
+
+        // tick closest to the deadline, past deadlines expire with the next tick
+        auto offset = std::max(t->m_deadline - m_start_time, steady_clock::duration(0));
+        auto tick = static_cast<uint64_t>((offset + m_resolution / 2) / m_resolution);
+        t->m_expiry_tick = std::max(tick, m_current + 1);
+        t->m_running = true;
+        link(t);
+        if(!m_advancing){ arm(); }
+    }
+
+    /*!
+     * return the next tick requiring processing, either an occupied slot on the lowest level
+     * or the next cascade from higher levels. requires a lock.
+     */
+    [[nodiscard]] uint64_t next_tick() const
+    {
+        auto index = m_current & slot_mask;
+        uint64_t pending = index == slot_mask ? 0 : m_occupied[0] & (~uint64_t(0) << (index + 1));
+        if(pending){ return (m_current & ~slot_mask) + std::countr_zero(pending); }
+        return (m_current | slot_mask) + 1;
+    }
+
+    /*!
+     * arm the asio-timer for the next tick requiring processing, if earlier than before. requires a lock.
+     */
+    void arm()
+    {
+        if(!m_num_timers){ return; }
+        auto tick = next_tick();
+        if(tick >= m_armed_tick){ return; }
+        m_armed_tick = tick;
+
+        std::weak_ptr<TimerServiceImpl> weak_self = weak_from_this();
+        m_timer.expires_at(m_start_time + tick * m_resolution);
+        m_timer.async_wait([weak_self](const boost::system::error_code &error)
+                           {
+                               auto self = weak_self.lock();
+                               if(!error && self){ self->advance(); }
+                           });
+    }
+
+    /*!
+     * move timers from the current slots of higher levels to lower levels. requires a lock.
+     */
+    void cascade()
     {
+        for(uint32_t level = 1; level < num_levels; ++level)
+        {
+            auto slot = (m_current >> (slot_bits * level)) & slot_mask;
+            timer_impl *t = m_slots[level][slot];
+            m_slots[level][slot] = nullptr;
+            m_occupied[level] &= ~(uint64_t(1) << slot);
+
+            while(t)
+            {
+                timer_impl *next = t->m_next;
+                m_num_timers--;
+                link(t);
+                t = next;
+            }
+
+            // higher levels only advance when this level wraps around
+            if(slot){ break; }
+        }
+    }
+
+    /*!
+     * process all ticks up to now, invoking callbacks of expired timers
+     */
+    void advance()
+    {
+        NETZER_TRACE_SPAN("TimerService::advance");
+        // expired timers, released after the lock
+        std::vector<std::shared_ptr<timer_impl>> expired;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_armed_tick = no_tick;
+        m_advancing = true;
+        auto target = now_tick();
+
+        while(m_current < target)
+        {
+            if(!m_num_timers)
+            {
+                m_current = target;
+                break;
+            }
+            m_current = std::min(next_tick(), target);
+            if(!(m_current & slot_mask)){ cascade(); }
+
+            auto &head = m_slots[0][m_current & slot_mask];
+
+            while(head)
+            {
+                timer_impl *t = head;
+                unlink(t);
+
+                // timer is being destroyed
+                auto impl = t->weak_from_this().lock();
+                if(!impl){ continue; }
+
+                impl->m_running = false;
+                impl->on_expire(steady_clock::now());
+                auto generation = impl->m_generation;
+                expired.push_back(impl);
+
+                // fire without holding the lock, callbacks might (re-)arm or cancel timers
+                lock.unlock();
+                if(impl->m_callback)
+                {
+                    NETZER_TRACE_SPAN("Timer::expire");
+                    impl->m_callback();
+                }
+                lock.lock();
+
+                // re-arm periodic timers, unless changed by the callback
+                if(impl->m_periodic && impl->m_generation == generation)
+                {
+                    impl->on_rearm(steady_clock::now());
+                    schedule(impl.get());
+                }
+
+                if(auto handle = impl->take_continuation(true))
+                {
+                    lock.unlock();
+                    handle.resume();
+                    lock.lock();
+                }
+            }
+        }
+        m_advancing = false;
+        arm();
+    }
+
+    /*!
+     * cancel all scheduled timers
+     */
+    void shutdown()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_shutdown = true;
+
+        for(auto &level: m_slots)
+        {
+            for(auto &head: level)
+            {
+                for(timer_impl *t = head; t;)
+                {
+                    timer_impl *next = t->m_next;
+                    t->m_prev = t->m_next = nullptr;
+                    t->m_level = -1;
+                    t->m_running = false;
+                    t->resume_cancelled(t->take_continuation(false));
+                    t = next;
+                }
+                head = nullptr;
+            }
+        }
+        m_occupied = {};
+        m_num_timers = 0;
+
         try{ m_timer.cancel(); }
         catch(boost::system::system_error &){}
     }
 };
 
+/////////////////////////////////////////////////////////////////////////
+
+void timer_impl::resume_cancelled(std::coroutine_handle<> handle)
+{
+    if(!handle){ return; }
+    auto executor = m_timer ? m_timer->get_executor() : m_service->m_timer.get_executor();
+    boost::asio::post(executor, [handle]{ handle.resume(); });
+}
+
+/////////////////////////////////////////////////////////////////////////
+
+timer_impl::~timer_impl()
+{
+    resume_cancelled(take_continuation(false));
+
+    if(m_timer)
+    {
+        try{ m_timer->cancel(); }
+        catch(boost::system::system_error &){}
+    }
+    if(m_service)
+    {
+        std::unique_lock<std::mutex> lock(m_service->m_mutex);
+        m_service->unlink(this);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////
+
+TimerService::TimerService(io_service_t &io, double resolution) :
+        m_impl(std::make_shared<TimerServiceImpl>(io, resolution)){}
+
+TimerService::~TimerService()
+{
+    if(m_impl){ m_impl->shutdown(); }
+}
+
+double TimerService::resolution() const
+{
+    return duration_cast<duration_t>(m_impl->m_resolution).count();
+}
+
+size_t TimerService::num_timers() const
+{
+    std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_num_timers;
+}
+
+/////////////////////////////////////////////////////////////////////////
+
 Timer::Timer(Timer &&other) noexcept:
         Timer()
 {
@@ -112,6 +584,9 @@ Timer::Timer(Timer &&other) noexcept:
 Timer::Timer(io_service_t &io, Timer::timer_cb_t cb) :
         m_impl(new timer_impl(io, std::move(cb))){}
 
+Timer::Timer(TimerService &service, Timer::timer_cb_t cb) :
+        m_impl(new timer_impl(service.m_impl, std::move(cb))){}
+
 Timer &Timer::operator=(Timer other)
 {
     swap(*this, other);
@@ -123,50 +598,79 @@ void swap(Timer &lhs, Timer &rhs)
     std::swap(lhs.m_impl, rhs.m_impl);
 }
 
+/*!
+ * lock the service of a timer, if any. timers with a dedicated asio-timer are not synchronized.
+ */
+static std::unique_lock<std::mutex> service_lock(const timer_impl &impl)
+{
+    return impl.m_service ? std::unique_lock<std::mutex>(impl.m_service->m_mutex) : std::unique_lock<std::mutex>();
+}
+
 void Timer::expires_from_now(double secs)
 {
     if(!m_impl){ return; }
-    std::weak_ptr<timer_impl> weak_impl = m_impl;
-
-    m_impl->m_timer.expires_from_now(duration_cast<steady_clock::duration>(duration_t(secs)));
-    m_impl->m_running = true;
+    auto lock = service_lock(*m_impl);
+    m_impl->m_interval = duration_cast<steady_clock::duration>(duration_t(secs));
+    m_impl->m_deadline = steady_clock::now() + m_impl->m_interval;
 
-    m_impl->m_timer.async_wait([this, weak_impl, secs](const boost::system::error_code &error)
-                               {
-                                   // Timer expired regularly
-                                   if(!error)
-                                   {
-                                       auto impl = weak_impl.lock();
-
-                                       if(impl)
-                                       {
-                                           impl->m_running = false;
-                                           if(impl->m_callback){ impl->m_callback(); }
-                                           if(impl->m_periodic){ expires_from_now(secs); }
-                                       }
-                                   }
-                               });
+    if(m_impl->m_service){ m_impl->m_service->schedule(m_impl.get()); }
+    else{ m_impl->arm(); }
 }
 
 double Timer::expires_from_now() const
 {
     if(!m_impl){ return 0.0; }
-    auto duration = m_impl->m_timer.expires_from_now();
+
+    if(m_impl->m_service)
+    {
+        const auto &service = *m_impl->m_service;
+        std::unique_lock<std::mutex> lock(service.m_mutex);
+        auto expiry = service.m_start_time + m_impl->m_expiry_tick * service.m_resolution;
+        return duration_cast<duration_t>(expiry - steady_clock::now()).count();
+    }
+    auto duration = m_impl->m_timer->expires_from_now();
     return duration_cast<duration_t>(duration).count();
 }
 
 bool Timer::has_expired() const
 {
-    return !(m_impl && m_impl->m_running);
+    if(!m_impl){ return true; }
+    auto lock = service_lock(*m_impl);
+    return !m_impl->m_running;
 }
 
 void Timer::cancel()
 {
-    if(m_impl)
+    if(!m_impl){ return; }
+    auto lock = service_lock(*m_impl);
+    m_impl->m_generation++;
+    m_impl->m_running = false;
+
+    if(m_impl->m_service){ m_impl->m_service->unlink(m_impl.get()); }
+    else{ m_impl->m_timer->cancel(); }
+    m_impl->resume_cancelled(m_impl->take_continuation(false));
+}
+
+Timer::awaitable_t Timer::after(double secs)
+{
+    return {this, std::max(secs, 0.0)};
+}
+
+Timer::awaitable_t Timer::next()
+{
+    return {this, -1.0};
+}
+
+void Timer::awaitable_t::await_suspend(std::coroutine_handle<> handle)
+{
+    auto &impl = timer->m_impl;
     {
-        m_impl->m_running = false;
-        m_impl->m_timer.cancel();
+        auto lock = service_lock(*impl);
+        impl->resume_cancelled(impl->take_continuation(false));
+        impl->m_continuation = handle;
+        impl->m_continuation_result = &expired;
     }
+    if(secs >= 0.0){ timer->expires_from_now(secs); }
 }
 
 bool Timer::periodic() const
@@ -176,11 +680,53 @@ bool Timer::periodic() const
 
 void Timer::set_periodic(bool b)
 {
-    if(m_impl){ m_impl->m_periodic = b; }
+    if(!m_impl){ return; }
+    auto lock = service_lock(*m_impl);
+    m_impl->m_periodic = b;
 }
 
 void Timer::set_callback(Timer::timer_cb_t cb)
 {
     if(m_impl){ m_impl->m_callback = std::move(cb); }
 }
+
+bool Timer::fixed_rate() const
+{
+    return m_impl && m_impl->m_fixed_rate;
+}
+
+void Timer::set_fixed_rate(bool b, missed_tick_policy_t policy)
+{
+    if(!m_impl){ return; }
+    auto lock = service_lock(*m_impl);
+    m_impl->m_fixed_rate = b;
+    m_impl->m_missed_tick_policy = policy;
+}
+
+missed_tick_policy_t Timer::missed_tick_policy() const
+{
+    return m_impl ? m_impl->m_missed_tick_policy : missed_tick_policy_t::SKIP;
+}
+
+uint64_t Timer::elapsed_ticks() const
+{
+    if(!m_impl){ return 0; }
+    auto lock = service_lock(*m_impl);
+    return m_impl->m_elapsed_ticks;
+}
+
+timer_stats_t Timer::stats() const
+{
+    if(!m_impl){ return {}; }
+    auto lock = service_lock(*m_impl);
+    return m_impl->m_stats;
+}
+
+void Timer::reset_stats()
+{
+    if(!m_impl){ return; }
+    auto lock = service_lock(*m_impl);
+    m_impl->m_stats = {};
+    m_impl->m_total_jitter = 0.0;
+}
 }//namespace
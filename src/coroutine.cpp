@@ -0,0 +1,66 @@
+#include <array>
+#include <vector>
+#include "netzer/coroutine.hpp"
+
+namespace netzer
+{
+
+namespace
+{
+// frames are cached in size-classes of 64 bytes, up to 4kB
+constexpr size_t g_frame_granularity = 64, g_num_frame_classes = 64, g_max_cached_frames = 32;
+
+struct frame_cache_t
+{
+    std::array<std::vector<void *>, g_num_frame_classes> frames;
+
+    ~frame_cache_t()
+    {
+        for(auto &size_class: frames)
+        {
+            for(void *ptr: size_class){ ::operator delete(ptr); }
+        }
+    }
+};
+
+thread_local frame_cache_t g_frame_cache;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void *allocate_frame(size_t num_bytes)
+{
+    size_t size_class = (num_bytes + g_frame_granularity - 1) / g_frame_granularity;
+    if(size_class >= g_num_frame_classes){ return ::operator new(num_bytes); }
+    auto &cached = g_frame_cache.frames[size_class];
+
+    if(!cached.empty())
+    {
+        void *ret = cached.back();
+        cached.pop_back();
+        return ret;
+    }
+    return ::operator new(size_class * g_frame_granularity);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void release_frame(void *ptr, size_t num_bytes)
+{
+    size_t size_class = (num_bytes + g_frame_granularity - 1) / g_frame_granularity;
+
+    if(size_class < g_num_frame_classes)
+    {
+        auto &cached = g_frame_cache.frames[size_class];
+
+        if(cached.size() < g_max_cached_frames)
+        {
+            if(cached.capacity() < g_max_cached_frames){ cached.reserve(g_max_cached_frames); }
+            cached.push_back(ptr);
+            return;
+        }
+    }
+    ::operator delete(ptr);
+}
+
+}// namespace
@@ -0,0 +1,69 @@
+#include <cmath>
+#include "netzer/histogram.hpp"
+
+namespace crocore
+{
+
+void histogram_t::add(double secs)
+{
+    record(static_cast<uint64_t>(std::llround(std::max(secs, 0.0) * 1.0e9)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void histogram_t::merge(const histogram_t &other)
+{
+    if(!other.count){ return; }
+    for(size_t i = 0; i < num_buckets; ++i){ buckets[i] += other.buckets[i]; }
+    min = count ? std::min(min, other.min) : other.min;
+    max = count ? std::max(max, other.max) : other.max;
+    sum += other.sum;
+    count += other.count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void histogram_t::reset()
+{
+    *this = {};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+double histogram_t::mean() const
+{
+    return count ? static_cast<double>(sum) / static_cast<double>(count) / 1.0e9 : 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+double histogram_t::percentile(double p) const
+{
+    return static_cast<double>(value_at_percentile(p)) / 1.0e9;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+uint64_t histogram_t::value_at_percentile(double p) const
+{
+    if(!count){ return 0; }
+    auto rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(std::clamp(p, 0.0, 1.0) *
+                                                                   static_cast<double>(count))), 1);
+    uint64_t num_samples = 0;
+
+    for(size_t i = 0; i < num_buckets; ++i)
+    {
+        num_samples += buckets[i];
+
+        if(num_samples >= rank)
+        {
+            // center of the bucket, clamped by observed extrema
+            uint64_t lower = bucket_lower_bound(i);
+            uint64_t width = i + 1 < num_buckets ? bucket_lower_bound(i + 1) - lower : 1;
+            return std::clamp(lower + (width - 1) / 2, min, max);
+        }
+    }
+    return max;
+}
+
+}// namespace
@@ -1,8 +1,21 @@
 #include <curl/curl.h>
+#include <zlib.h>
+#include <algorithm>
+#include <string_view>
 #include <mutex>
+#include <cctype>
 #include <cstring>
+#include <cmath>
+#include <ctime>
 #include <map>
+#include <list>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <atomic>
+#include <thread>
 #include "netzer/http.hpp"
+#include "netzer/trace.hpp"
 
 using duration_t = std::chrono::duration<double>;
 
@@ -14,6 +27,177 @@ using handle_map_t = std::map<CURL *, ActionPtr>;
 
 ///////////////////////////////////////////////////////////////////////////////
 
+/*!
+ * extract the host-part from an url, returns an empty string for malformed urls
+ */
+static std::string host_from_url(const std::string &url)
+{
+    std::string ret;
+    std::unique_ptr<CURLU, decltype(&curl_url_cleanup)> handle(curl_url(), curl_url_cleanup);
+    char *host = nullptr;
+
+    if(!curl_url_set(handle.get(), CURLUPART_URL, url.c_str(), CURLU_GUESS_SCHEME) &&
+       !curl_url_get(handle.get(), CURLUPART_HOST, &host, 0))
+    {
+        ret = host;
+        curl_free(host);
+    }
+    return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ * gzip-compress a buffer, returns an empty vector on failure
+ */
+static std::vector<uint8_t> gzip_compress(const std::vector<uint8_t> &data, int level)
+{
+    z_stream stream = {};
+    if(deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK){ return {}; }
+
+    std::vector<uint8_t> ret(deflateBound(&stream, static_cast<uLong>(data.size())));
+    stream.next_in = const_cast<Bytef *>(data.data());
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = ret.data();
+    stream.avail_out = static_cast<uInt>(ret.size());
+    int res = deflate(&stream, Z_FINISH);
+    ret.resize(stream.total_out);
+    deflateEnd(&stream);
+    return res == Z_STREAM_END ? ret : std::vector<uint8_t>();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ * streaming decoder for gzip- or deflate-encoded content
+ */
+class ZlibDecoder
+{
+public:
+    ZlibDecoder() { inflateInit2(&m_stream, 15 + 32); }
+
+    ~ZlibDecoder() { inflateEnd(&m_stream); }
+
+    ZlibDecoder(const ZlibDecoder &) = delete;
+
+    ZlibDecoder &operator=(const ZlibDecoder &) = delete;
+
+    /*!
+     * decode a chunk of input, append decoded bytes to <out>. returns false on corrupt input.
+     */
+    bool decode(const uint8_t *data, size_t num_bytes, std::vector<uint8_t> &out)
+    {
+        constexpr size_t chunk_size = 1U << 14;
+
+        // keep input until the first decoded byte, to replay it as raw deflate if necessary
+        if(!m_raw && !m_has_output){ m_consumed.insert(m_consumed.end(), data, data + num_bytes); }
+
+        m_stream.next_in = const_cast<Bytef *>(data);
+        m_stream.avail_in = static_cast<uInt>(num_bytes);
+        bool ret = true;
+
+        do
+        {
+            size_t offset = out.size();
+            out.resize(offset + chunk_size);
+            m_stream.next_out = out.data() + offset;
+            m_stream.avail_out = static_cast<uInt>(chunk_size);
+            int res = inflate(&m_stream, Z_NO_FLUSH);
+            out.resize(offset + chunk_size - m_stream.avail_out);
+            m_has_output = m_has_output || out.size() > offset;
+
+            if(res == Z_STREAM_END)
+            {
+                // concatenated gzip-members
+                if(!m_stream.avail_in){ break; }
+                inflateReset(&m_stream);
+            }
+            else if(res == Z_DATA_ERROR && !m_raw && !m_has_output)
+            {
+                // some servers send 'deflate' without zlib-header -> retry all input as raw deflate
+                m_raw = true;
+                inflateEnd(&m_stream);
+                m_stream = {};
+                inflateInit2(&m_stream, -15);
+                m_stream.next_in = m_consumed.data();
+                m_stream.avail_in = static_cast<uInt>(m_consumed.size());
+            }
+            else if(res == Z_BUF_ERROR && m_stream.avail_out){ break; }
+            else if(res != Z_OK && res != Z_BUF_ERROR){ ret = false; break; }
+        } while(m_stream.avail_in || !m_stream.avail_out);
+
+        // no replay possible anymore, release the input
+        if(m_raw || m_has_output){ std::vector<uint8_t>().swap(m_consumed); }
+        return ret;
+    }
+
+private:
+    z_stream m_stream = {};
+    bool m_raw = false, m_has_output = false;
+
+    // input consumed before the first decoded byte
+    std::vector<uint8_t> m_consumed;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ * intrusive, unbounded multi-producer/single-consumer queue (Vyukov).
+ * push is wait-free (a single atomic exchange), pop must only be called by one consumer.
+ */
+template<typename T>
+class MPSCQueue
+{
+public:
+    MPSCQueue() : m_head(new node_t), m_tail(m_head.load()){}
+
+    MPSCQueue(const MPSCQueue &) = delete;
+
+    MPSCQueue &operator=(const MPSCQueue &) = delete;
+
+    ~MPSCQueue()
+    {
+        T value;
+        while(pop(value)){}
+        delete m_tail;
+    }
+
+    void push(T value)
+    {
+        auto node = new node_t;
+        node->value = std::move(value);
+        auto prev = m_head.exchange(node, std::memory_order_acq_rel);
+
+        // queue is briefly disconnected here, the consumer treats this as empty
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    bool pop(T &value)
+    {
+        auto next = m_tail->next.load(std::memory_order_acquire);
+        if(!next){ return false; }
+
+        // 'next' becomes the new stub
+        value = std::move(next->value);
+        delete m_tail;
+        m_tail = next;
+        return true;
+    }
+
+private:
+    struct node_t
+    {
+        std::atomic<node_t *> next = nullptr;
+        T value;
+    };
+
+    // producers append at head, the consumer removes from tail
+    std::atomic<node_t *> m_head;
+    node_t *m_tail;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
 struct ClientImpl
 {
     std::shared_ptr<CURLM> m_curl_multi_handle;
@@ -21,421 +205,2392 @@ struct ClientImpl
     // map containing current handles
     handle_map_t m_handle_map;
 
-    // mutex to protect the handle-map
-    std::mutex m_mutex;
+    // queued actions and their submission-time, ordered by priority and submission
+    std::map<std::pair<int, uint64_t>, std::pair<ActionPtr, std::chrono::steady_clock::time_point>> m_queue;
+
+    // number of transfers in flight, per host
+    std::map<std::string, uint32_t> m_host_connections;
+
+    // actions answered from cache, pending completion
+    std::vector<ActionPtr> m_cached_actions;
+
+    // queued or running GET/HEAD requests, used to coalesce identical requests
+    std::unordered_map<std::string, ActionPtr> m_coalesce_map;
+
+    // flag indicating if identical GET/HEAD requests should be coalesced (opt-in)
+    bool m_coalesce = false;
+
+    // optional response-cache
+    CachePtr m_cache;
+
+    // mutex to protect the handle-map and queue
+    mutable std::mutex m_mutex;
 
     // connection timeout in ms
     uint64_t m_timeout;
 
+    // minimum interval between progress-reports in seconds
+    double m_progress_interval = Client::DEFAULT_PROGRESS_INTERVAL;
+
+    // limits for concurrent transfers (0: unlimited)
+    uint32_t m_max_connections, m_max_host_connections;
+
     // number of running transfers
     int m_num_connections;
 
+    // running counter, keeps FIFO-order for requests with equal priority
+    uint64_t m_queue_counter = 0;
+
+    // queue metrics
+    queue_stats_t m_queue_stats;
+    double m_total_wait = 0.0;
+
+    // default policies for retries and hedged requests
+    retry_policy_t m_retry_policy;
+    hedge_policy_t m_hedge_policy;
+
+    // actions waiting for a retry, ordered by due-time
+    std::multimap<std::chrono::steady_clock::time_point, ActionPtr> m_delayed;
+
+    struct token_bucket_t
+    {
+        rate_limit_t limit;
+        double tokens = 0.0;
+        std::chrono::steady_clock::time_point last_refill;
+
+        // requests are held back until this point in time (Retry-After)
+        std::chrono::steady_clock::time_point blocked_until;
+
+        void configure(const rate_limit_t &l, std::chrono::steady_clock::time_point now)
+        {
+            limit = l;
+            tokens = std::max(limit.burst, 1.0);
+            last_refill = now;
+        }
+
+        // return the point in time when the next request may proceed
+        std::chrono::steady_clock::time_point due(std::chrono::steady_clock::time_point now)
+        {
+            auto ret = std::max(now, blocked_until);
+            if(limit.rate <= 0.0){ return ret; }
+
+            // add tokens for elapsed time
+            tokens = std::min(std::max(limit.burst, 1.0), tokens + limit.rate * duration_t(now - last_refill).count());
+            last_refill = now;
+
+            if(tokens < 1.0)
+            {
+                ret = std::max(ret, now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        duration_t((1.0 - tokens) / limit.rate)));
+            }
+            return ret;
+        }
+
+        void consume() { if(limit.rate > 0.0){ tokens -= 1.0; } }
+    };
+
+    // global rate-limit (as configured and share of this instance) and per-host limits,
+    // per-host buckets also track Retry-After
+    rate_limit_t m_rate_limit;
+    token_bucket_t m_rate_limiter;
+    std::map<std::string, token_bucket_t> m_host_rate_limiters;
+
+    // next point in time a throttled request may proceed
+    std::chrono::steady_clock::time_point m_throttle_due = std::chrono::steady_clock::time_point::max();
+
+    // aggregated timings per host
+    std::map<std::string, host_stats_t> m_host_stats;
+
+    // settings and metrics for content-encoding
+    compression_policy_t m_compression_policy;
+    compression_stats_t m_compression_stats;
+
+    // ring-buffer with recent latencies (in seconds), used to derive the hedging-delay
+    std::vector<double> m_latencies;
+    size_t m_latency_index = 0;
+    double m_hedge_delay = 0.0;
+
+    struct submission_t
+    {
+        request_t request;
+        completion_cb_t completion_cb;
+        progress_cb_t progress_cb;
+        error_cb_t error_cb;
+    };
+
+    // requests submitted while an io-thread is running, drained by poll()
+    MPSCQueue<submission_t> m_submissions;
+
+    // set while a wakeup for new submissions is pending, avoids redundant wakeups
+    std::atomic<bool> m_wakeup_pending = false;
+
+    struct hot_origin_state_t
+    {
+        hot_origin_t config;
+        std::string host;
+
+        // time of the next warm-up
+        std::chrono::steady_clock::time_point due;
+    };
+
+    // hot origins, keyed by origin
+    std::map<std::string, hot_origin_state_t> m_hot_origins;
+
+    // running warm-up requests
+    std::unordered_set<ActionPtr> m_warmups;
+
+    // additional shards with independent multi-handles, owned by the first shard
+    std::vector<std::unique_ptr<ClientImpl>> m_shards;
+
+    // optional io-thread and executor for handlers
+    std::thread m_io_thread;
+    std::atomic<bool> m_io_running = false;
+    executor_t m_executor;
+
     explicit ClientImpl() :
             m_curl_multi_handle(curl_multi_init(), curl_multi_cleanup),
             m_timeout(Client::DEFAULT_TIMEOUT),
-            m_num_connections(0) {};
+            m_max_connections(Client::DEFAULT_MAX_CONNECTIONS),
+            m_max_host_connections(Client::DEFAULT_MAX_HOST_CONNECTIONS),
+            m_num_connections(0){};
+
+    ~ClientImpl()
+    {
+        // detach running transfers, before their handles are released
+        for(const auto &[handle, action]: m_handle_map){ curl_multi_remove_handle(m_curl_multi_handle.get(), handle); }
+    }
 
     void poll();
 
-    void add_action(const ActionPtr &action, completion_cb_t ch, progress_cb_t ph = progress_cb_t());
+    // return the shard responsible for the host of an url
+    ClientImpl &shard(const std::string &url);
+
+    // apply a function to all shards, including this instance
+    template<typename F>
+    void for_each_shard(F f)
+    {
+        f(*this);
+        for(auto &s: m_shards){ f(*s); }
+    }
+
+    // submit a request, passed to the io-thread if one is running
+    void submit(request_t request, completion_cb_t ch, progress_cb_t ph = {}, error_cb_t eh = {});
+
+    void add_request(request_t request, completion_cb_t ch, progress_cb_t ph = {}, error_cb_t eh = {});
+
+    // move all pending submissions into the queue
+    void drain_submissions();
+
+    // wake up the io-thread, if running
+    void wakeup();
+
+    // run-loop for the io-thread
+    void run_io();
+
+    // return the time in ms the io-thread may block waiting for activity
+    int io_timeout();
+
+    // dispatch queued actions, or defer to the io-thread. requires a lock.
+    void schedule_dispatch();
+
+    // create an action for the provided request, applying compression-settings
+    ActionPtr create_action(request_t request, const compression_policy_t &compression);
+
+    void add_action(const ActionPtr &action, completion_cb_t ch, progress_cb_t ph = {}, error_cb_t eh = {});
+
+    // add an action to the queue. requires a lock.
+    void enqueue(const ActionPtr &action);
+
+    // move queued actions to the multi-handle, as far as connection-limits permit. requires a lock.
+    void dispatch_queued();
+
+    // returns true, if limits permit another transfer for the provided host. requires a lock.
+    [[nodiscard]] bool has_free_slot(const std::string &host) const;
+
+    // take a token from global and host rate-limits, if available. requires a lock.
+    bool acquire_token(const std::string &host, std::chrono::steady_clock::time_point now);
+
+    // hold back requests to a host, e.g. after receiving a Retry-After header. requires a lock.
+    void block_host(const std::string &host, std::chrono::steady_clock::time_point until);
+
+    // add an action to the multi-handle. requires a lock.
+    void start(const ActionPtr &action, std::chrono::steady_clock::time_point now);
+
+    // remove a running action from the multi-handle and release its slot. requires a lock.
+    void stop(const ActionPtr &action);
+
+    // raise the priority of a queued action. requires a lock.
+    void promote(const ActionPtr &action, priority_t priority);
+
+    // evaluate a finished transfer, decides about retries and hedges. requires a lock.
+    void finish(const ActionPtr &action, CURLcode res,
+                std::vector<ActionPtr> &completed,
+                std::vector<std::pair<ActionPtr, std::string>> &failed);
+
+    // issue hedge-requests for slow transfers. requires a lock.
+    void issue_hedges(std::chrono::steady_clock::time_point now);
+
+    // record a latency-sample and update the hedging-delay. requires a lock.
+    void add_latency(double secs);
+
+    // issue warm-up requests for hot origins that are due. requires a lock.
+    void warm_origins(std::chrono::steady_clock::time_point now);
+
+    // postpone warm-ups for a host with recent traffic. requires a lock.
+    void touch_origins(const std::string &host, std::chrono::steady_clock::time_point now);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct CacheImpl
+{
+    struct entry_t
+    {
+        // immutable snapshot of the cached response, shared with pending revalidations
+        std::shared_ptr<const response_t> response;
+
+        // validators
+        std::string etag, last_modified;
+
+        // point in time when this entry becomes stale
+        std::chrono::steady_clock::time_point expires;
+
+        size_t num_bytes = 0;
+
+        std::list<std::string>::iterator lru_itr;
+    };
+
+    // lookup-result for an url
+    struct lookup_t
+    {
+        std::shared_ptr<const response_t> response;
+        bool fresh = false;
+        std::string etag, last_modified;
+    };
+
+    std::unordered_map<std::string, entry_t> m_entries;
+
+    // urls, most recently used first
+    std::list<std::string> m_lru;
+
+    size_t m_max_bytes;
+    cache_stats_t m_stats;
+    mutable std::mutex m_mutex;
+
+    explicit CacheImpl(size_t max_bytes) : m_max_bytes(max_bytes){}
+
+    lookup_t lookup(const std::string &url)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        lookup_t ret;
+        auto itr = m_entries.find(url);
+
+        if(itr != m_entries.end())
+        {
+            auto &entry = itr->second;
+            m_lru.splice(m_lru.begin(), m_lru, entry.lru_itr);
+            ret.response = entry.response;
+            ret.fresh = std::chrono::steady_clock::now() < entry.expires;
+            ret.etag = entry.etag;
+            ret.last_modified = entry.last_modified;
+            if(ret.fresh){ m_stats.num_hits++; }
+        }
+        return ret;
+    }
+
+    /*!
+     * process a response for a request that was issued with a preceding lookup.
+     * a 304 is replaced with the cached content, cacheable responses are stored.
+     */
+    void process(const std::string &url, const std::shared_ptr<const response_t> &cached, response_t &response)
+    {
+        if(response.status_code == 304 && cached)
+        {
+            auto headers = std::move(response.headers);
+            response.status_code = cached->status_code;
+            response.data = cached->data;
+            response.headers = cached->headers;
+
+            // 304 may carry updated meta-data
+            for(auto &[k, v]: headers){ response.headers[k] = std::move(v); }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_stats.num_revalidated++;
+            store(url, response);
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_stats.num_misses++;
+            if(response.status_code == 200){ store(url, response); }
+        }
+    }
+
+    // requires a lock
+    void store(const std::string &url, const response_t &response)
+    {
+        auto get_header = [&response](const std::string &key) -> std::string
+        {
+            auto itr = response.headers.find(key);
+            return itr != response.headers.end() ? itr->second : std::string();
+        };
+        auto cache_control = get_header("cache-control");
+        std::transform(cache_control.begin(), cache_control.end(), cache_control.begin(),
+                       [](unsigned char c){ return std::tolower(c); });
+
+        entry_t entry;
+        entry.etag = get_header("etag");
+        entry.last_modified = get_header("last-modified");
+
+        // freshness lifetime in seconds
+        int64_t lifetime = 0;
+        auto max_age_pos = cache_control.find("max-age=");
+
+        if(max_age_pos != std::string::npos)
+        {
+            lifetime = std::strtoll(cache_control.c_str() + max_age_pos + 8, nullptr, 10);
+        }
+        else if(!get_header("expires").empty())
+        {
+            auto expires = curl_getdate(get_header("expires").c_str(), nullptr);
+            auto date = get_header("date").empty() ? time(nullptr) : curl_getdate(get_header("date").c_str(), nullptr);
+            if(expires >= 0 && date >= 0){ lifetime = expires - date; }
+        }
+        if(!get_header("age").empty()){ lifetime -= std::strtoll(get_header("age").c_str(), nullptr, 10); }
+        if(cache_control.find("no-cache") != std::string::npos){ lifetime = 0; }
+
+        bool cacheable = cache_control.find("no-store") == std::string::npos &&
+                         (lifetime > 0 || !entry.etag.empty() || !entry.last_modified.empty());
+
+        remove(url);
+        if(!cacheable){ return; }
+
+        entry.expires = std::chrono::steady_clock::now() + std::chrono::seconds(std::max<int64_t>(lifetime, 0));
+        entry.num_bytes = response.data.size() + url.size();
+        for(const auto &[k, v]: response.headers){ entry.num_bytes += k.size() + v.size(); }
+        if(entry.num_bytes > m_max_bytes){ return; }
+
+        auto snapshot = std::make_shared<response_t>();
+        snapshot->status_code = response.status_code;
+        snapshot->headers = response.headers;
+        snapshot->data = response.data;
+        entry.response = std::move(snapshot);
+
+        m_lru.push_front(url);
+        entry.lru_itr = m_lru.begin();
+        m_stats.num_bytes += entry.num_bytes;
+        m_entries[url] = std::move(entry);
+        evict(m_max_bytes);
+    }
+
+    // requires a lock
+    void remove(const std::string &url)
+    {
+        auto itr = m_entries.find(url);
+
+        if(itr != m_entries.end())
+        {
+            m_stats.num_bytes -= itr->second.num_bytes;
+            m_lru.erase(itr->second.lru_itr);
+            m_entries.erase(itr);
+        }
+    }
+
+    // evict least recently used entries, until content fits into the provided budget. requires a lock.
+    void evict(size_t max_bytes)
+    {
+        while(m_stats.num_bytes > max_bytes && !m_lru.empty()){ remove(m_lru.back()); }
+    }
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
-class CurlAction
+class CurlAction
+{
+private:
+    // upper bound for pre-allocating response-bodies from a content-length header
+    static constexpr size_t MAX_BODY_RESERVE = 64 * (1 << 20);
+
+    std::unique_ptr<CURL, std::function<void(CURL*)>> m_curl_handle;
+    std::chrono::steady_clock::time_point m_start_time;
+    std::string m_host;
+    priority_t m_priority = priority_t::NORMAL;
+    method_t m_method = method_t::GET;
+
+    // subscribers, more than one for coalesced requests
+    std::vector<completion_cb_t> m_completion_handlers;
+    std::vector<progress_cb_t> m_progress_handlers;
+    std::vector<error_cb_t> m_error_handlers;
+
+    // minimum interval between progress-reports
+    std::chrono::steady_clock::duration m_progress_interval{};
+    std::chrono::steady_clock::time_point m_last_progress;
+
+    response_t m_response;
+
+    // payload for uploads and current read-position
+    const std::vector<uint8_t> *m_upload = nullptr;
+    size_t m_upload_offset = 0;
+
+    // content-decoding for compressed responses
+    bool m_accept_encoding = false;
+    std::unique_ptr<ZlibDecoder> m_decoder;
+
+    // compression-metrics, reported and reset after each attempt
+    compression_stats_t m_compression_stats;
+
+    // human-readable error-message, provided by curl
+    char m_error_buffer[CURL_ERROR_SIZE] = {};
+
+    // retry-policy and number of retries so far
+    retry_policy_t m_retry_policy = {};
+    uint32_t m_num_retries = 0;
+
+    // start-time for the current attempt
+    std::chrono::steady_clock::time_point m_dispatch_time;
+
+    // set while held back by rate-limits
+    bool m_throttled = false;
+
+    // request-description, kept to issue hedge-requests
+    std::optional<request_t> m_request;
+
+    // links between a primary request and its hedge-request
+    ActionPtr m_primary;
+    std::weak_ptr<CurlAction> m_hedge;
+    bool m_hedged = false;
+
+    // additional request-headers
+    std::shared_ptr<struct curl_slist> m_headers;
+
+    // response-cache and snapshot of a cached response, pending revalidation
+    CachePtr m_cache;
+    std::shared_ptr<const response_t> m_cached_response;
+    bool m_from_cache = false;
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    /*!
+     * callback to process incoming data
+     */
+    static size_t write_static(void *buffer, size_t num_elems, size_t num_elem_bytes, void *userp)
+    {
+        size_t num_bytes = num_elems * num_elem_bytes;
+
+        if(userp)
+        {
+            auto *ourAction = static_cast<CurlAction *>(userp);
+            auto *buf_start = (uint8_t *)(buffer);
+            uint8_t *buf_end = buf_start + num_bytes;
+
+            if(ourAction->m_accept_encoding)
+            {
+                auto &stats = ourAction->m_compression_stats;
+                auto &data = ourAction->m_response.data;
+
+                // first chunk of body -> check content-encoding
+                if(!stats.num_bytes_received)
+                {
+                    auto itr = ourAction->m_response.headers.find("content-encoding");
+                    bool encoded = false;
+
+                    // content-codings are case-insensitive, header-values are trimmed already
+                    if(itr != ourAction->m_response.headers.end())
+                    {
+                        auto coding = itr->second;
+                        std::transform(coding.begin(), coding.end(), coding.begin(),
+                                       [](unsigned char c){ return std::tolower(c); });
+                        encoded = coding == "gzip" || coding == "x-gzip" || coding == "deflate";
+                    }
+                    ourAction->m_decoder = encoded ? std::make_unique<ZlibDecoder>() : nullptr;
+                }
+                stats.num_bytes_received += num_bytes;
+
+                if(ourAction->m_decoder)
+                {
+                    auto start_time = std::chrono::steady_clock::now();
+                    size_t size_before = data.size();
+                    bool success = ourAction->m_decoder->decode(buf_start, num_bytes, data);
+                    stats.num_bytes_decoded += data.size() - size_before;
+                    stats.decode_time += duration_t(std::chrono::steady_clock::now() - start_time).count();
+
+                    // signals an error to curl
+                    return success ? num_bytes : 0;
+                }
+                stats.num_bytes_decoded += num_bytes;
+            }
+            ourAction->m_response.data.insert(ourAction->m_response.data.end(), buf_start, buf_end);
+        }
+        return num_bytes;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    /*!
+     * callback to process incoming headers, one line at a time
+     */
+    static size_t header_static(char *buffer, size_t num_elems, size_t num_elem_bytes, void *userp)
+    {
+        size_t num_bytes = num_elems * num_elem_bytes;
+        auto *self = static_cast<CurlAction *>(userp);
+        std::string_view line(buffer, num_bytes);
+
+        // new status-line (e.g. after redirects or 100-continue) -> discard previous headers
+        if(line.starts_with("HTTP/")){ self->m_response.headers.clear(); }
+        else
+        {
+            auto colon_pos = line.find(':');
+
+            if(colon_pos != std::string_view::npos)
+            {
+                std::string key(line.substr(0, colon_pos));
+                std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c){ return std::tolower(c); });
+                auto value = line.substr(colon_pos + 1);
+                auto begin = value.find_first_not_of(" \t");
+                auto end = value.find_last_not_of(" \t\r\n");
+                bool is_content_length = key == "content-length";
+                auto &header_value = self->m_response.headers[std::move(key)];
+                header_value = begin == std::string_view::npos ?
+                        std::string() : std::string(value.substr(begin, end - begin + 1));
+
+                // known body-size -> avoid repeated reallocation while receiving
+                if(is_content_length)
+                {
+                    auto num_bytes_body = std::strtoull(header_value.c_str(), nullptr, 10);
+                    self->m_response.data.reserve(std::min<size_t>(num_bytes_body, MAX_BODY_RESERVE));
+                }
+            }
+        }
+        return num_bytes;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    /*!
+     * callback for data provided to Curl for sending
+     */
+    static size_t read_static(void *ptr, size_t num_elems, size_t num_elem_bytes, void *userp)
+    {
+        auto *self = static_cast<CurlAction *>(userp);
+        if(!self->m_upload){ return 0; }
+        size_t num_bytes = std::min(num_elems * num_elem_bytes, self->m_upload->size() - self->m_upload_offset);
+        memcpy(ptr, self->m_upload->data() + self->m_upload_offset, num_bytes);
+        self->m_upload_offset += num_bytes;
+        return num_bytes;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    /*!
+     * callback to monitor transfer progress
+     */
+    static int progress_static(void *userp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ult, curl_off_t uln)
+    {
+        auto *self = static_cast<CurlAction *>(userp);
+        if(self->m_progress_handlers.empty()){ return 0; }
+        auto &con = self->m_response.connection;
+
+        // curl invokes this frequently, also while idle -> report changes only, at most once per interval
+        bool changed = static_cast<double>(dlnow) != con.dl_now || static_cast<double>(uln) != con.ul_now;
+        bool finished = (dltotal && dlnow == dltotal) || (ult && uln == ult);
+        if(!changed){ return 0; }
+
+        auto now = std::chrono::steady_clock::now();
+        if(!finished && now - self->m_last_progress < self->m_progress_interval){ return 0; }
+        self->m_last_progress = now;
+
+        con.dl_total = static_cast<double>(dltotal);
+        con.dl_now = static_cast<double>(dlnow);
+        con.ul_total = static_cast<double>(ult);
+        con.ul_now = static_cast<double>(uln);
+        for(const auto &progress_handler: self->m_progress_handlers){ progress_handler(con); }
+        return 0;
+    }
+
+public:
+    explicit CurlAction(const std::string &the_url) :
+            m_curl_handle(curl_easy_init(), curl_easy_cleanup),
+            m_start_time(std::chrono::steady_clock::now())
+    {
+        m_response.connection = {the_url, 0, 0, 0, 0, 0};
+        m_host = host_from_url(the_url);
+        curl_easy_setopt(handle(), CURLOPT_WRITEDATA, this);
+        curl_easy_setopt(handle(), CURLOPT_WRITEFUNCTION, write_static);
+        curl_easy_setopt(handle(), CURLOPT_HEADERDATA, this);
+        curl_easy_setopt(handle(), CURLOPT_HEADERFUNCTION, header_static);
+        curl_easy_setopt(handle(), CURLOPT_READDATA, this);
+        curl_easy_setopt(handle(), CURLOPT_READFUNCTION, read_static);
+        curl_easy_setopt(handle(), CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(handle(), CURLOPT_XFERINFODATA, this);
+        curl_easy_setopt(handle(), CURLOPT_XFERINFOFUNCTION, progress_static);
+        curl_easy_setopt(handle(), CURLOPT_ERRORBUFFER, m_error_buffer);
+        curl_easy_setopt(handle(), CURLOPT_URL, the_url.c_str());
+    };
+
+    virtual ~CurlAction() = default;
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    response_t &response() { return m_response; };
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    bool perform()
+    {
+        if(served_from_cache())
+        {
+            complete();
+            return true;
+        }
+        CURLcode curlResult = curl_easy_perform(handle());
+        curl_easy_getinfo(handle(), CURLINFO_RESPONSE_CODE, &m_response.status_code);
+        collect_timing();
+        m_response.duration = duration();
+        if(!curlResult){ process_cache(); }
+        if(!curlResult){ complete(); }
+        return !curlResult;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    /*!
+     * append a raw request-header (e.g. "Content-Type: application/json")
+     */
+    void add_header(const std::string &header)
+    {
+        auto *list = curl_slist_append(m_headers.get(), header.c_str());
+        if(!list){ return; }
+        if(m_headers.get() != list){ m_headers = std::shared_ptr<struct curl_slist>(list, curl_slist_free_all); }
+        curl_easy_setopt(handle(), CURLOPT_HTTPHEADER, m_headers.get());
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    /*!
+     * attach a response-cache. fresh content is copied into the response right away,
+     * stale content gets revalidated using conditional request-headers.
+     */
+    void set_cache(CachePtr cache)
+    {
+        m_cache = std::move(cache);
+        if(!m_cache){ return; }
+        auto lookup = m_cache->m_impl->lookup(m_response.connection.url);
+
+        if(lookup.fresh)
+        {
+            m_response.status_code = lookup.response->status_code;
+            m_response.headers = lookup.response->headers;
+            m_response.data = lookup.response->data;
+            m_response.duration = duration();
+            m_from_cache = true;
+        }
+        else if(lookup.response)
+        {
+            m_cached_response = std::move(lookup.response);
+            if(!lookup.etag.empty()){ add_header("If-None-Match: " + lookup.etag); }
+            if(!lookup.last_modified.empty()){ add_header("If-Modified-Since: " + lookup.last_modified); }
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    /*!
+     * returns true, if the response was served from cache and no transfer is required
+     */
+    [[nodiscard]] bool served_from_cache() const { return m_from_cache; }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    /*!
+     * pass a completed response to an attached cache. resolves 304-responses with cached content.
+     */
+    void process_cache()
+    {
+        if(m_cache){ m_cache->m_impl->process(m_response.connection.url, m_cached_response, m_response); }
+        m_cached_response.reset();
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    [[nodiscard]] CURL *handle() const { return m_curl_handle.get(); }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    [[nodiscard]] connection_info_t connection_info() const { return m_response.connection; }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    void add_completion_handler(completion_cb_t ch) { if(ch){ m_completion_handlers.push_back(std::move(ch)); }}
+
+    void add_progress_handler(progress_cb_t ph) { if(ph){ m_progress_handlers.push_back(std::move(ph)); }}
+
+    void add_error_handler(error_cb_t eh) { if(eh){ m_error_handlers.push_back(std::move(eh)); }}
+
+    /*!
+     * fire all completion-handlers. subscribers share the same response, no copies are involved.
+     */
+    void complete()
+    {
+        for(const auto &completion_handler: m_completion_handlers){ completion_handler(m_response); }
+    }
+
+    /*!
+     * fire all error-handlers
+     */
+    void fail(const std::string &error)
+    {
+        for(const auto &error_handler: m_error_handlers){ error_handler(m_response.connection, error); }
+    }
+
+    /*!
+     * request gzip/deflate-encoded responses, which are decoded while streaming into the response-body
+     */
+    void set_accept_encoding(bool b)
+    {
+        if(b && !m_accept_encoding){ add_header("Accept-Encoding: gzip, deflate"); }
+        m_accept_encoding = b;
+
+        // decoding is done on our end
+        curl_easy_setopt(handle(), CURLOPT_HTTP_CONTENT_DECODING, 0L);
+    }
+
+    /*!
+     * add compression-metrics for the last attempt to <stats> and reset them.
+     * request-body metrics are thereby reported once per request, not per attempt.
+     */
+    void report_compression(compression_stats_t &stats)
+    {
+        stats.num_bytes_received += m_compression_stats.num_bytes_received;
+        stats.num_bytes_decoded += m_compression_stats.num_bytes_decoded;
+        stats.num_bytes_raw += m_compression_stats.num_bytes_raw;
+        stats.num_bytes_sent += m_compression_stats.num_bytes_sent;
+        stats.decode_time += m_compression_stats.decode_time;
+        stats.encode_time += m_compression_stats.encode_time;
+
+        // the request-body is compressed once, retries must not count it again
+        m_compression_stats = {};
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    /*!
+     * query the timing-breakdown of a finished transfer
+     */
+    void collect_timing()
+    {
+        auto get_time = [this](CURLINFO info) -> double
+        {
+            curl_off_t us = 0;
+            curl_easy_getinfo(handle(), info, &us);
+            return static_cast<double>(us) / 1.0e6;
+        };
+        auto &timing = m_response.timing;
+        double name_lookup = get_time(CURLINFO_NAMELOOKUP_TIME_T);
+        double connect = get_time(CURLINFO_CONNECT_TIME_T);
+        double app_connect = get_time(CURLINFO_APPCONNECT_TIME_T);
+        timing.dns = name_lookup;
+        timing.connect = std::max(connect - name_lookup, 0.0);
+        timing.tls = app_connect > 0.0 ? std::max(app_connect - connect, 0.0) : 0.0;
+        timing.ttfb = get_time(CURLINFO_STARTTRANSFER_TIME_T);
+        timing.total = get_time(CURLINFO_TOTAL_TIME_T);
+
+        long num_connects = 0;
+        curl_easy_getinfo(handle(), CURLINFO_NUM_CONNECTS, &num_connects);
+        timing.connection_reused = !num_connects;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    /*!
+     * return a description for the last error, reported by curl
+     */
+    [[nodiscard]] std::string error_message(CURLcode code) const
+    {
+        return m_error_buffer[0] ? std::string(m_error_buffer) : std::string(curl_easy_strerror(code));
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    [[nodiscard]] const retry_policy_t &retry_policy() const { return m_retry_policy; }
+
+    void set_retry_policy(const retry_policy_t &policy) { m_retry_policy = policy; }
+
+    [[nodiscard]] bool can_retry() const { return m_num_retries < m_retry_policy.max_retries; }
+
+    /*!
+     * returns true, if the status-code indicates a transient failure, worth a retry
+     */
+    [[nodiscard]] bool retry_status() const
+    {
+        switch(m_response.status_code)
+        {
+            case 408:
+            case 429:
+            case 500:
+            case 502:
+            case 503:
+            case 504:
+                return m_retry_policy.retry_status;
+            default:
+                return false;
+        }
+    }
+
+    /*!
+     * return the delay (in seconds) requested by a Retry-After header of a 429/503 response, if any
+     */
+    [[nodiscard]] std::optional<double> retry_after() const
+    {
+        if(!m_retry_policy.respect_retry_after ||
+           (m_response.status_code != 429 && m_response.status_code != 503)){ return {}; }
+        auto itr = m_response.headers.find("retry-after");
+        if(itr == m_response.headers.end() || itr->second.empty()){ return {}; }
+        double secs;
+
+        // either delay-seconds or an HTTP-date
+        if(std::all_of(itr->second.begin(), itr->second.end(), [](unsigned char c){ return std::isdigit(c); }))
+        {
+            secs = std::strtod(itr->second.c_str(), nullptr);
+        }
+        else
+        {
+            auto date = curl_getdate(itr->second.c_str(), nullptr);
+            if(date < 0){ return {}; }
+            secs = std::difftime(date, time(nullptr));
+        }
+        return std::clamp(secs, 0.0, m_retry_policy.max_retry_after);
+    }
+
+    /*!
+     * prepare for another attempt and return the backoff-delay in seconds
+     */
+    double retry()
+    {
+        static thread_local std::mt19937 rng(std::random_device{}());
+        const auto &p = m_retry_policy;
+        double backoff = std::min(p.backoff * std::pow(p.multiplier, m_num_retries++), p.max_backoff);
+        backoff *= 1.0 - std::clamp(p.jitter, 0.0, 1.0) * std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        reset();
+        return backoff;
+    }
+
+    /*!
+     * discard results of a previous attempt
+     */
+    void reset()
+    {
+        m_response.status_code = 0;
+        m_response.headers.clear();
+        m_response.data.clear();
+        m_upload_offset = 0;
+        m_decoder.reset();
+        m_error_buffer[0] = 0;
+        m_hedged = false;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    [[nodiscard]] std::chrono::steady_clock::time_point dispatch_time() const { return m_dispatch_time; }
+
+    void set_dispatch_time(std::chrono::steady_clock::time_point t) { m_dispatch_time = t; }
+
+    [[nodiscard]] bool throttled() const { return m_throttled; }
+
+    void set_throttled(bool b) { m_throttled = b; }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    [[nodiscard]] const std::optional<request_t> &request() const { return m_request; }
+
+    void set_request(std::optional<request_t> request) { m_request = std::move(request); }
+
+    [[nodiscard]] const ActionPtr &primary() const { return m_primary; }
+
+    void set_primary(ActionPtr primary) { m_primary = std::move(primary); }
+
+    [[nodiscard]] ActionPtr hedge() const { return m_hedge.lock(); }
+
+    void set_hedge(const ActionPtr &hedge)
+    {
+        m_hedge = hedge;
+        m_hedged = m_hedged || hedge;
+    }
+
+    /*!
+     * returns true, if a hedge-request was issued for the current attempt
+     */
+    [[nodiscard]] bool hedged() const { return m_hedged; }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    [[nodiscard]] method_t method() const { return m_method; }
+
+    void set_method(method_t method)
+    {
+        m_method = method;
+        if(m_method == method_t::HEAD){ curl_easy_setopt(handle(), CURLOPT_NOBODY, 1L); }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    [[nodiscard]] const std::string &host() const { return m_host; }
+
+    [[nodiscard]] priority_t priority() const { return m_priority; }
+
+    void set_priority(priority_t p) { m_priority = p; }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    void set_timeout(uint64_t timeout)
+    {
+        m_response.connection.timeout = timeout;
+        curl_easy_setopt(handle(), CURLOPT_TIMEOUT, timeout);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    void set_progress_interval(double secs)
+    {
+        m_progress_interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(duration_t(secs));
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    [[nodiscard]] double duration() const
+    {
+        return duration_t(std::chrono::steady_clock::now() - m_start_time).count();
+    }
+
+protected:
+
+    void set_upload(const std::vector<uint8_t> *data) { m_upload = data; }
+
+    compression_stats_t &compression_stats() { return m_compression_stats; }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+using Action_GET = CurlAction;
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ * base for actions transmitting a payload
+ */
+class UploadAction : public CurlAction
+{
+protected:
+    std::vector<uint8_t> m_data;
+
+    // apply the current payload to the handle
+    virtual void apply_payload() = 0;
+
+public:
+    UploadAction(const std::string &the_url,
+                 std::vector<uint8_t> the_data,
+                 const std::string &the_mime_type) :
+            CurlAction(the_url),
+            m_data(std::move(the_data))
+    {
+        add_header("Content-Type: " + the_mime_type);
+        compression_stats().num_bytes_raw = compression_stats().num_bytes_sent = m_data.size();
+    }
+
+    /*!
+     * gzip-compress the payload, if it is at least <threshold> bytes in size and actually shrinks
+     */
+    void compress(size_t threshold, int level)
+    {
+        if(!threshold || m_data.size() < threshold){ return; }
+        auto start_time = std::chrono::steady_clock::now();
+        auto compressed = gzip_compress(m_data, level);
+        compression_stats().encode_time += duration_t(std::chrono::steady_clock::now() - start_time).count();
+
+        if(!compressed.empty() && compressed.size() < m_data.size())
+        {
+            m_data = std::move(compressed);
+            compression_stats().num_bytes_sent = m_data.size();
+            add_header("Content-Encoding: gzip");
+            apply_payload();
+        }
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+class Action_POST : public UploadAction
+{
+protected:
+    void apply_payload() override
+    {
+        curl_easy_setopt(handle(), CURLOPT_POSTFIELDS, m_data.data());
+        curl_easy_setopt(handle(), CURLOPT_POSTFIELDSIZE, static_cast<curl_off_t>(m_data.size()));
+    }
+
+public:
+    Action_POST(const std::string &the_url,
+                std::vector<uint8_t> the_data,
+                const std::string &the_mime_type) :
+            UploadAction(the_url, std::move(the_data), the_mime_type)
+    {
+        set_method(method_t::POST);
+        curl_easy_setopt(handle(), CURLOPT_URL, the_url.c_str());
+        Action_POST::apply_payload();
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+class Action_PUT : public UploadAction
+{
+protected:
+    void apply_payload() override
+    {
+        set_upload(&m_data);
+        curl_easy_setopt(handle(), CURLOPT_INFILESIZE_LARGE, static_cast<curl_off_t>(m_data.size()));
+    }
+
+public:
+    Action_PUT(const std::string &the_url,
+               std::vector<uint8_t> the_data,
+               const std::string &the_mime_type) :
+            UploadAction(the_url, std::move(the_data), the_mime_type)
+    {
+        set_method(method_t::PUT);
+        curl_easy_setopt(handle(), CURLOPT_URL, the_url.c_str());
+
+        /* HTTP PUT please */
+        curl_easy_setopt(handle(), CURLOPT_UPLOAD, 1L);
+        Action_PUT::apply_payload();
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+class Action_DELETE : public CurlAction
+{
+public:
+    explicit Action_DELETE(const std::string &the_url) :
+            CurlAction(the_url)
+    {
+        set_method(method_t::DEL);
+        curl_easy_setopt(handle(), CURLOPT_CUSTOMREQUEST, "DELETE");
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ * key used to identify identical requests
+ */
+static std::string coalesce_key(const CurlAction &action)
+{
+    return (action.method() == method_t::HEAD ? "HEAD " : "GET ") + action.connection_info().url;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+CachePtr Cache::create(size_t max_bytes)
+{
+    return CachePtr(new Cache(max_bytes));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Cache::Cache(size_t max_bytes) :
+        m_impl(std::make_unique<CacheImpl>(max_bytes))
+{
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Cache::~Cache() = default;
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t Cache::max_bytes() const
+{
+    std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_max_bytes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Cache::set_max_bytes(size_t max_bytes)
+{
+    std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+    m_impl->m_max_bytes = max_bytes;
+    m_impl->evict(max_bytes);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Cache::clear()
+{
+    std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+    m_impl->evict(0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+cache_stats_t Cache::stats() const
+{
+    std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+    auto ret = m_impl->m_stats;
+    ret.num_entries = m_impl->m_entries.size();
+    auto num_requests = ret.num_hits + ret.num_revalidated + ret.num_misses;
+    if(num_requests){ ret.hit_ratio = double(ret.num_hits + ret.num_revalidated) / double(num_requests); }
+    return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+response_t head(const std::string &url)
+{
+    ActionPtr url_action = std::make_unique<Action_GET>(url);
+    url_action->set_method(method_t::HEAD);
+    url_action->perform();
+    return std::move(url_action->response());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+response_t get(const std::string &url, const CachePtr &cache)
+{
+    ActionPtr url_action = std::make_unique<Action_GET>(url);
+    url_action->set_cache(cache);
+    url_action->perform();
+    return std::move(url_action->response());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+response_t post(const std::string &url,
+                const std::vector<uint8_t> &data,
+                const std::string &mime_type)
+{
+    ActionPtr url_action = std::make_shared<Action_POST>(url, data, mime_type);
+    url_action->perform();
+    return std::move(url_action->response());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+response_t put(const std::string &url,
+               const std::vector<uint8_t> &data,
+               const std::string &mime_type)
+{
+    ActionPtr url_action = std::make_shared<Action_PUT>(url, data, mime_type);
+    url_action->perform();
+    return std::move(url_action->response());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+response_t del(const std::string &url)
+{
+    ActionPtr url_action = std::make_shared<Action_DELETE>(url);
+    url_action->perform();
+    return std::move(url_action->response());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::vector<response_t> batch(const std::vector<request_t> &requests, const batch_options_t &options)
+{
+    // identical GET/HEAD requests may be coalesced and share a response -> copy those, move all others
+    std::unordered_map<std::string, size_t> num_identical;
+    auto key = [](const request_t &r){ return (r.method == method_t::HEAD ? "HEAD " : "GET ") + r.url; };
+
+    for(const auto &r: requests)
+    {
+        if(r.method == method_t::GET || r.method == method_t::HEAD){ num_identical[key(r)]++; }
+    }
+
+    std::vector<response_t> ret(requests.size());
+    batch(requests, [&](size_t index, response_t &response)
+    {
+        const auto &r = requests[index];
+        bool shared = options.coalesce && (r.method == method_t::GET || r.method == method_t::HEAD) &&
+                      num_identical[key(r)] > 1;
+        if(shared){ ret[index] = response; }
+        else{ ret[index] = std::move(response); }
+    }, options);
+    return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void batch(const std::vector<request_t> &requests, const batch_cb_t &callback, const batch_options_t &options)
+{
+    auto start_time = std::chrono::steady_clock::now();
+    auto deadline = start_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            duration_t(options.deadline));
+
+    // a private client, driven on the calling thread
+    ClientImpl impl;
+    impl.m_max_connections = options.max_connections;
+    impl.m_max_host_connections = options.max_host_connections;
+    impl.m_coalesce = options.coalesce;
+
+    std::vector<bool> finished(requests.size(), false);
+    size_t num_finished = 0;
+
+    auto finish = [&](size_t index, response_t &response)
+    {
+        if(finished[index]){ return; }
+        finished[index] = true;
+        num_finished++;
+        if(callback){ callback(index, response); }
+    };
+
+    for(size_t i = 0; i < requests.size(); ++i)
+    {
+        impl.submit(requests[i],
+                    [&finish, i](response_t &response){ finish(i, response); }, {},
+                    [&finish, i](const connection_info_t &info, const std::string &)
+                    {
+                        response_t response;
+                        response.connection = info;
+                        finish(i, response);
+                    });
+    }
+
+    while(num_finished < requests.size())
+    {
+        impl.poll();
+        if(num_finished == requests.size()){ break; }
+        int timeout = impl.io_timeout();
+
+        if(options.deadline > 0.0)
+        {
+            auto now = std::chrono::steady_clock::now();
+            if(now >= deadline){ break; }
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1;
+            timeout = static_cast<int>(std::min<int64_t>(timeout, remaining));
+        }
+        curl_multi_poll(impl.m_curl_multi_handle.get(), nullptr, 0, timeout, nullptr);
+    }
+
+    // deadline exceeded
+    for(size_t i = 0; i < requests.size(); ++i)
+    {
+        if(!finished[i])
+        {
+            response_t response;
+            response.connection.url = requests[i].url;
+            finish(i, response);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Client::Client(uint32_t num_shards) :
+        m_impl(std::make_unique<ClientImpl>())
+{
+    for(uint32_t i = 1; i < num_shards; ++i){ m_impl->m_shards.push_back(std::make_unique<ClientImpl>()); }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Client::~Client()
+{
+    if(m_impl){ stop_io_thread(); }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Client &Client::operator=(Client other)
+{
+    std::swap(m_impl, other.m_impl);
+    return *this;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::poll()
+{
+    NETZER_TRACE_SPAN("http::Client::poll");
+    drain_submissions();
+    curl_multi_perform(m_curl_multi_handle.get(), &m_num_connections);
+    std::vector<ActionPtr> completed;
+    std::vector<std::pair<ActionPtr, std::string>> failed;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        completed.swap(m_cached_actions);
+        int msgs_left;
+        CURLMsg *msg = curl_multi_info_read(m_curl_multi_handle.get(), &msgs_left);
+
+        while(msg)
+        {
+            if(msg->msg == CURLMSG_DONE)
+            {
+                CURL *easy = msg->easy_handle;
+                CURLcode res = msg->data.result;
+                auto itr = m_handle_map.find(easy);
+
+                if(itr != m_handle_map.end())
+                {
+                    auto action = itr->second;
+                    stop(action);
+
+                    // warm-ups only leave a connection in the cache
+                    if(m_warmups.erase(action))
+                    {
+                        msg = curl_multi_info_read(m_curl_multi_handle.get(), &msgs_left);
+                        continue;
+                    }
+
+                    // http response code
+                    if(!res){ curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &action->response().status_code); }
+                    action->collect_timing();
+                    action->report_compression(m_compression_stats);
+                    finish(action, res, completed, failed);
+                }
+                else{ curl_multi_remove_handle(m_curl_multi_handle.get(), easy); }
+            }
+            msg = curl_multi_info_read(m_curl_multi_handle.get(), &msgs_left);
+        }
+        auto now = std::chrono::steady_clock::now();
+
+        // re-enqueue actions due for a retry
+        while(!m_delayed.empty() && m_delayed.begin()->first <= now)
+        {
+            enqueue(m_delayed.begin()->second);
+            m_delayed.erase(m_delayed.begin());
+        }
+        issue_hedges(now);
+
+        // promote queued requests into freed slots
+        dispatch_queued();
+        warm_origins(now);
+    }
+
+    // fire handlers without holding the lock, handlers might issue new requests
+    for(auto &action: completed)
+    {
+        if(!action->served_from_cache()){ action->process_cache(); }
+
+        if(m_executor){ m_executor([action]{ action->complete(); }); }
+        else{ action->complete(); }
+    }
+    for(auto &[action, error]: failed)
+    {
+        if(m_executor){ m_executor([action = action, error = std::move(error)]{ action->fail(error); }); }
+        else{ action->fail(error); }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ClientImpl &ClientImpl::shard(const std::string &url)
+{
+    if(m_shards.empty()){ return *this; }
+
+    // host-affinity keeps connections to a host within one multi-handle
+    auto index = std::hash<std::string>()(host_from_url(url)) % (m_shards.size() + 1);
+    return index ? *m_shards[index - 1] : *this;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::submit(request_t request, completion_cb_t ch, progress_cb_t ph, error_cb_t eh)
+{
+    if(m_io_running.load(std::memory_order_acquire))
+    {
+        m_submissions.push({std::move(request), std::move(ch), std::move(ph), std::move(eh)});
+        wakeup();
+    }
+    else{ add_request(std::move(request), std::move(ch), std::move(ph), std::move(eh)); }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::drain_submissions()
+{
+    m_wakeup_pending.store(false, std::memory_order_release);
+    submission_t submission;
+
+    while(m_submissions.pop(submission))
+    {
+        add_request(std::move(submission.request), std::move(submission.completion_cb),
+                    std::move(submission.progress_cb), std::move(submission.error_cb));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::wakeup()
+{
+    if(!m_wakeup_pending.exchange(true, std::memory_order_acq_rel))
+    {
+        curl_multi_wakeup(m_curl_multi_handle.get());
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::schedule_dispatch()
+{
+    // the multi-handle is owned by the io-thread
+    if(m_io_running.load(std::memory_order_acquire))
+    {
+        curl_multi_wakeup(m_curl_multi_handle.get());
+    }
+    else{ dispatch_queued(); }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::run_io()
+{
+    while(m_io_running.load(std::memory_order_acquire))
+    {
+        poll();
+        curl_multi_poll(m_curl_multi_handle.get(), nullptr, 0, io_timeout(), nullptr);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int ClientImpl::io_timeout()
+{
+    // upper bound, keeps the io-thread responsive without relying on wakeups
+    constexpr long max_timeout = 1000;
+    long timeout = -1;
+    curl_multi_timeout(m_curl_multi_handle.get(), &timeout);
+    if(timeout < 0 || timeout > max_timeout){ timeout = max_timeout; }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // pending results from cache
+    if(!m_cached_actions.empty()){ return 0; }
+
+    // next retry due
+    if(!m_delayed.empty())
+    {
+        auto due = std::chrono::duration_cast<std::chrono::milliseconds>(m_delayed.begin()->first -
+                                                                         std::chrono::steady_clock::now());
+        timeout = std::clamp<long>(static_cast<long>(due.count()) + 1, 0, timeout);
+    }
+
+    // next token for requests held back by rate-limits
+    if(!m_queue.empty() && m_throttle_due != std::chrono::steady_clock::time_point::max())
+    {
+        auto due = std::chrono::duration_cast<std::chrono::milliseconds>(m_throttle_due -
+                                                                         std::chrono::steady_clock::now());
+        timeout = std::clamp<long>(static_cast<long>(due.count()) + 1, 0, timeout);
+    }
+
+    // next warm-up for hot origins
+    for(const auto &[origin, state]: m_hot_origins)
+    {
+        if(state.due == std::chrono::steady_clock::time_point::max()){ continue; }
+        auto due = std::chrono::duration_cast<std::chrono::milliseconds>(state.due - std::chrono::steady_clock::now());
+        timeout = std::clamp<long>(static_cast<long>(due.count()) + 1, 0, timeout);
+    }
+
+    // running transfers might require a hedge
+    if(m_hedge_policy.enabled && !m_handle_map.empty())
+    {
+        auto min_delay = static_cast<long>(m_hedge_policy.min_delay * 1000.0);
+        timeout = std::min(timeout, std::max(min_delay, 1L));
+    }
+    return static_cast<int>(timeout);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::finish(const ActionPtr &action, CURLcode res,
+                        std::vector<ActionPtr> &completed,
+                        std::vector<std::pair<ActionPtr, std::string>> &failed)
+{
+    // a hedge-request reports to its primary, which holds all subscribers
+    bool is_hedge = action->primary() != nullptr;
+    ActionPtr primary = is_hedge ? action->primary() : action;
+    ActionPtr sibling = is_hedge ? primary : primary->hedge();
+    bool sibling_running = sibling && m_handle_map.count(sibling->handle());
+    bool success = !res && !(action->retry_status() && primary->can_retry());
+
+    if(!success && sibling_running)
+    {
+        // the other attempt is still running and decides
+        action->set_primary(nullptr);
+        return;
+    }
+    if(sibling_running){ stop(sibling); }
+
+    // first response wins, the primary takes over the response of a winning hedge
+    if(is_hedge){ primary->response() = std::move(action->response()); }
+    action->set_primary(nullptr);
+    primary->set_hedge(nullptr);
+
+    // server asks to back off -> hold back all requests to this host
+    auto retry_after = primary->retry_after();
+    auto retry_after_duration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            duration_t(retry_after.value_or(0.0)));
+    if(retry_after){ block_host(primary->host(), std::chrono::steady_clock::now() + retry_after_duration); }
+
+    if(success)
+    {
+        const auto &timing = primary->response().timing;
+        auto &host_stats = m_host_stats[primary->host()];
+        host_stats.num_requests++;
+        host_stats.num_reused_connections += timing.connection_reused ? 1 : 0;
+        host_stats.dns.add(timing.dns);
+        host_stats.connect.add(timing.connect);
+        host_stats.tls.add(timing.tls);
+        host_stats.ttfb.add(timing.ttfb);
+        host_stats.total.add(timing.total);
+        touch_origins(primary->host(), std::chrono::steady_clock::now());
+        add_latency(duration_t(std::chrono::steady_clock::now() - primary->dispatch_time()).count());
+    }
+    else if(primary->can_retry())
+    {
+        m_queue_stats.num_retries++;
+        auto backoff = std::max(std::chrono::duration_cast<std::chrono::steady_clock::duration>(duration_t(primary->retry())),
+                                retry_after_duration);
+        m_delayed.emplace(std::chrono::steady_clock::now() + backoff, primary);
+        return;
+    }
+
+    // final result -> no further subscribers for this transfer
+    auto coalesce_itr = m_coalesce_map.find(coalesce_key(*primary));
+
+    if(coalesce_itr != m_coalesce_map.end() && coalesce_itr->second == primary)
+    {
+        m_coalesce_map.erase(coalesce_itr);
+    }
+    primary->response().duration = primary->duration();
+
+    // transfers failing with a retryable status still deliver their last response
+    if(!res){ completed.push_back(primary); }
+    else
+    {
+        m_queue_stats.num_errors++;
+        failed.emplace_back(primary, action->error_message(res));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ActionPtr ClientImpl::create_action(request_t request, const compression_policy_t &compression)
+{
+    ActionPtr url_action;
+    std::shared_ptr<UploadAction> upload_action;
+
+    switch(request.method)
+    {
+        case method_t::HEAD:
+            url_action = std::make_shared<Action_GET>(request.url);
+            url_action->set_method(method_t::HEAD);
+            break;
+        case method_t::GET:
+            url_action = std::make_shared<Action_GET>(request.url);
+            break;
+        case method_t::POST:
+            url_action = upload_action = std::make_shared<Action_POST>(request.url, std::move(request.data),
+                                                                       request.mime_type);
+            break;
+        case method_t::PUT:
+            url_action = upload_action = std::make_shared<Action_PUT>(request.url, std::move(request.data),
+                                                                      request.mime_type);
+            break;
+        case method_t::DEL:
+            url_action = std::make_shared<Action_DELETE>(request.url);
+            break;
+    }
+    url_action->set_priority(request.priority);
+    if(compression.accept_encoding){ url_action->set_accept_encoding(true); }
+    if(upload_action){ upload_action->compress(compression.request_threshold, compression.level); }
+    return url_action;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::add_request(request_t request, completion_cb_t ch, progress_cb_t ph, error_cb_t eh)
+{
+    CachePtr cache;
+    retry_policy_t retry_policy;
+    compression_policy_t compression;
+    bool hedge;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        cache = m_cache;
+        retry_policy = request.retry ? *request.retry : m_retry_policy;
+        hedge = request.hedge ? *request.hedge : m_hedge_policy.enabled;
+        compression = m_compression_policy;
+    }
+    bool idempotent = request.method != method_t::POST;
+    hedge = hedge && idempotent;
+    std::optional<request_t> request_copy;
+    if(hedge){ request_copy = request; }
+
+    bool is_get = request.method == method_t::GET;
+    auto url_action = create_action(std::move(request), compression);
+    if(is_get){ url_action->set_cache(cache); }
+    if(idempotent){ url_action->set_retry_policy(retry_policy); }
+    url_action->set_request(std::move(request_copy));
+    add_action(url_action, std::move(ch), std::move(ph), std::move(eh));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::add_action(const ActionPtr &action, completion_cb_t ch, progress_cb_t ph, error_cb_t eh)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // set options for this handle
+    action->set_timeout(m_timeout);
+    action->set_progress_interval(m_progress_interval);
+
+    // identical GET/HEAD request already queued or running -> subscribe to its response
+    if(m_coalesce && !action->served_from_cache() &&
+       (action->method() == method_t::GET || action->method() == method_t::HEAD))
+    {
+        auto [itr, inserted] = m_coalesce_map.try_emplace(coalesce_key(*action), action);
+
+        if(!inserted)
+        {
+            const auto &leader = itr->second;
+            leader->add_completion_handler(std::move(ch));
+            leader->add_progress_handler(std::move(ph));
+            leader->add_error_handler(std::move(eh));
+            if(action->priority() > leader->priority()){ promote(leader, action->priority()); }
+            m_queue_stats.num_coalesced++;
+            return;
+        }
+    }
+    action->add_completion_handler(std::move(ch));
+    action->add_progress_handler(std::move(ph));
+    action->add_error_handler(std::move(eh));
+
+    // fresh content from cache, no transfer required
+    if(action->served_from_cache())
+    {
+        m_cached_actions.push_back(action);
+        return;
+    }
+    enqueue(action);
+
+    // add handle to multi, if limits permit
+    dispatch_queued();
+
+//    if(m_io_service && !m_num_connections)
+//    {
+//        m_io_service->post([this] { poll(); });
+//    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::enqueue(const ActionPtr &action)
+{
+    auto key = std::make_pair(-static_cast<int>(action->priority()), m_queue_counter++);
+    m_queue[key] = {action, std::chrono::steady_clock::now()};
+    m_queue_stats.max_queue_depth = std::max(m_queue_stats.max_queue_depth, m_queue.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::dispatch_queued()
+{
+    auto now = std::chrono::steady_clock::now();
+    m_throttle_due = std::chrono::steady_clock::time_point::max();
+
+    for(auto itr = m_queue.begin(); itr != m_queue.end();)
+    {
+        if(m_max_connections && m_handle_map.size() >= m_max_connections){ break; }
+        auto &[action, queue_time] = itr->second;
+
+        // host is saturated, lower-priority requests for other hosts may still proceed
+        if(!has_free_slot(action->host()))
+        {
+            ++itr;
+            continue;
+        }
+
+        // rate-limited or blocked by Retry-After, paced instead of rejected
+        if(!acquire_token(action->host(), now))
+        {
+            if(!action->throttled()){ m_queue_stats.num_throttled++; }
+            action->set_throttled(true);
+
+            // global limit exhausted -> no request may proceed
+            if(m_rate_limiter.due(now) > now){ break; }
+            ++itr;
+            continue;
+        }
+        action->set_throttled(false);
+
+        double wait = duration_t(now - queue_time).count();
+        m_total_wait += wait;
+        m_queue_stats.max_wait = std::max(m_queue_stats.max_wait, wait);
+        m_queue_stats.num_dispatched++;
+
+        start(action, now);
+        itr = m_queue.erase(itr);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ClientImpl::has_free_slot(const std::string &host) const
+{
+    if(m_max_connections && m_handle_map.size() >= m_max_connections){ return false; }
+    if(!m_max_host_connections){ return true; }
+    auto itr = m_host_connections.find(host);
+    return itr == m_host_connections.end() || itr->second < m_max_host_connections;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ClientImpl::acquire_token(const std::string &host, std::chrono::steady_clock::time_point now)
+{
+    auto due = m_rate_limiter.due(now);
+    auto host_itr = m_host_rate_limiters.find(host);
+
+    if(host_itr != m_host_rate_limiters.end())
+    {
+        auto &bucket = host_itr->second;
+        due = std::max(due, bucket.due(now));
+
+        // expired block without a rate-limit
+        if(bucket.limit.rate <= 0.0 && bucket.blocked_until <= now)
+        {
+            m_host_rate_limiters.erase(host_itr);
+            host_itr = m_host_rate_limiters.end();
+        }
+    }
+
+    if(due > now)
+    {
+        m_throttle_due = std::min(m_throttle_due, due);
+        return false;
+    }
+    m_rate_limiter.consume();
+    if(host_itr != m_host_rate_limiters.end()){ host_itr->second.consume(); }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::block_host(const std::string &host, std::chrono::steady_clock::time_point until)
+{
+    auto &bucket = m_host_rate_limiters[host];
+    bucket.blocked_until = std::max(bucket.blocked_until, until);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::start(const ActionPtr &action, std::chrono::steady_clock::time_point now)
+{
+    m_host_connections[action->host()]++;
+    action->set_dispatch_time(now);
+
+    // add handle to multi
+    m_handle_map[action->handle()] = action;
+    curl_multi_add_handle(m_curl_multi_handle.get(), action->handle());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::stop(const ActionPtr &action)
+{
+    curl_multi_remove_handle(m_curl_multi_handle.get(), action->handle());
+    m_handle_map.erase(action->handle());
+
+    // release connection-slot for this host
+    auto host_itr = m_host_connections.find(action->host());
+    if(host_itr != m_host_connections.end() && !--host_itr->second){ m_host_connections.erase(host_itr); }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::promote(const ActionPtr &action, priority_t priority)
+{
+    action->set_priority(priority);
+
+    for(auto itr = m_queue.begin(); itr != m_queue.end(); ++itr)
+    {
+        if(itr->second.first == action)
+        {
+            auto key = std::make_pair(-static_cast<int>(priority), itr->first.second);
+            auto value = std::move(itr->second);
+            m_queue.erase(itr);
+            m_queue[key] = std::move(value);
+            break;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::issue_hedges(std::chrono::steady_clock::time_point now)
+{
+    // no hedging-delay derived from samples yet -> use upper bound
+    auto delay = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            duration_t(m_hedge_delay > 0.0 ? m_hedge_delay : m_hedge_policy.max_delay));
+    std::vector<ActionPtr> candidates;
+
+    for(const auto &[handle, action]: m_handle_map)
+    {
+        if(action->request() && !action->primary() && !action->hedged() && now - action->dispatch_time() >= delay)
+        {
+            candidates.push_back(action);
+        }
+    }
+
+    for(const auto &action: candidates)
+    {
+        if(!has_free_slot(action->host()) || !acquire_token(action->host(), now)){ continue; }
+
+        // duplicate the request, the first response wins
+        auto hedge = create_action(*action->request(), m_compression_policy);
+        hedge->set_timeout(m_timeout);
+        hedge->set_progress_interval(m_progress_interval);
+        hedge->set_primary(action);
+        action->set_hedge(hedge);
+        m_queue_stats.num_hedges++;
+        start(hedge, now);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::add_latency(double secs)
+{
+    constexpr size_t num_samples = 256, min_num_samples = 16;
+
+    if(m_latencies.size() < num_samples){ m_latencies.push_back(secs); }
+    else{ m_latencies[m_latency_index++ % num_samples] = secs; }
+
+    if(m_hedge_policy.enabled && m_latencies.size() >= min_num_samples)
+    {
+        auto samples = m_latencies;
+        auto nth = samples.begin() + static_cast<int>(std::clamp(m_hedge_policy.percentile, 0.0, 1.0) *
+                                                      static_cast<double>(samples.size() - 1));
+        std::nth_element(samples.begin(), nth, samples.end());
+        m_hedge_delay = std::clamp(*nth, m_hedge_policy.min_delay, m_hedge_policy.max_delay);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::warm_origins(std::chrono::steady_clock::time_point now)
+{
+    for(auto &[origin, state]: m_hot_origins)
+    {
+        if(state.due > now){ continue; }
+        auto url = origin;
+        if(!url.empty() && url.back() == '/'){ url.pop_back(); }
+        url += state.config.path;
+
+        for(uint32_t i = 0; i < state.config.num_connections; ++i)
+        {
+            // warm-ups respect connection-limits
+            if((m_max_connections && m_handle_map.size() >= m_max_connections) || !has_free_slot(state.host) ||
+               !acquire_token(state.host, now)){ break; }
+            auto action = std::make_shared<Action_GET>(url);
+            action->set_method(method_t::HEAD);
+            action->set_timeout(m_timeout);
+            m_warmups.insert(action);
+            start(action, now);
+            m_queue_stats.num_warmups++;
+        }
+        state.due = state.config.keep_warm_interval > 0.0
+                    ? now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                            duration_t(state.config.keep_warm_interval))
+                    : std::chrono::steady_clock::time_point::max();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ClientImpl::touch_origins(const std::string &host, std::chrono::steady_clock::time_point now)
+{
+    for(auto &[origin, state]: m_hot_origins)
+    {
+        if(state.host == host && state.config.keep_warm_interval > 0.0)
+        {
+            state.due = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    duration_t(state.config.keep_warm_interval));
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Client::async_head(const std::string &url,
+                        completion_cb_t ch,
+                        progress_cb_t ph)
+{
+    request_t request;
+    request.method = method_t::HEAD;
+    request.url = url;
+    m_impl->shard(request.url).submit(std::move(request), std::move(ch), std::move(ph));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Client::async_get(const std::string &url,
+                       completion_cb_t completion_cb,
+                       progress_cb_t ph)
+{
+    request_t request;
+    request.url = url;
+    m_impl->shard(request.url).submit(std::move(request), std::move(completion_cb), std::move(ph));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Client::async_post(const std::string &url,
+                        const std::vector<uint8_t> &data,
+                        completion_cb_t completion_cb,
+                        const std::string &mime_type,
+                        progress_cb_t progress_cb)
+{
+    request_t request;
+    request.method = method_t::POST;
+    request.url = url;
+    request.data = data;
+    request.mime_type = mime_type;
+    m_impl->shard(request.url).submit(std::move(request), std::move(completion_cb), std::move(progress_cb));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Client::async_put(const std::string &url,
+                       const std::vector<uint8_t> &data,
+                       completion_cb_t completion_cb,
+                       const std::string &mime_type,
+                       progress_cb_t progress_cb)
 {
-private:
-    std::unique_ptr<CURL, std::function<void(CURL*)>> m_curl_handle;
-    std::chrono::steady_clock::time_point m_start_time;
-    completion_cb_t m_completion_handler;
-    progress_cb_t m_progress_handler;
-    response_t m_response;
+    request_t request;
+    request.method = method_t::PUT;
+    request.url = url;
+    request.data = data;
+    request.mime_type = mime_type;
+    m_impl->shard(request.url).submit(std::move(request), std::move(completion_cb), std::move(progress_cb));
+}
 
-    ///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
 
-    /*!
-     * callback to process incoming data
-     */
-    static size_t write_static(void *buffer, size_t num_elems, size_t num_elem_bytes, void *userp)
-    {
-        size_t num_bytes = num_elems * num_elem_bytes;
+void Client::async_del(const std::string &url, completion_cb_t completion_cb)
+{
+    request_t request;
+    request.method = method_t::DEL;
+    request.url = url;
+    m_impl->shard(request.url).submit(std::move(request), std::move(completion_cb));
+}
 
-        if(userp)
-        {
-            auto *ourAction = static_cast<CurlAction *>(userp);
-            auto *buf_start = (uint8_t *)(buffer);
-            uint8_t *buf_end = buf_start + num_bytes;
-            ourAction->m_response.data.insert(ourAction->m_response.data.end(), buf_start, buf_end);
-        }
-        return num_bytes;
-    }
+///////////////////////////////////////////////////////////////////////////////
 
-    ///////////////////////////////////////////////////////////////////////////////
+void Client::async_request(const request_t &request,
+                           completion_cb_t completion_cb,
+                           progress_cb_t progress_cb,
+                           error_cb_t error_cb)
+{
+    m_impl->shard(request.url).submit(request, std::move(completion_cb), std::move(progress_cb), std::move(error_cb));
+}
 
-    /*!
-     * callback for data provided to Curl for sending
-     */
-    static size_t read_static(void *ptr, size_t num_elems, size_t num_elem_bytes, void *in)
-    {
-        size_t max_num_bytes = num_elems * num_elem_bytes;
-        size_t num_bytes = max_num_bytes;
-        memcpy(ptr, in, num_bytes);
-        return num_bytes;
-    }
+///////////////////////////////////////////////////////////////////////////////
 
-    ///////////////////////////////////////////////////////////////////////////////
+uint64_t Client::timeout() const
+{
+    std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_timeout;
+}
 
-    /*!
-     * callback to monitor transfer progress
-     */
-    static int progress_static(void *userp, double dltotal, double dlnow, double ult, double uln)
-    {
-        auto *self = static_cast<CurlAction *>(userp);
-        auto &con = self->m_response.connection;
-        con.dl_total = dltotal;
-        con.dl_now = dlnow;
-        con.ul_total = ult;
-        con.ul_now = uln;
-        if(self->m_progress_handler){ self->m_progress_handler(con); }
-        return 0;
-    }
+///////////////////////////////////////////////////////////////////////////////
 
-public:
-    explicit CurlAction(const std::string &the_url) :
-            m_curl_handle(curl_easy_init(), curl_easy_cleanup),
-            m_start_time(std::chrono::steady_clock::now())
-    {
-        m_response.connection = {the_url, 0, 0, 0, 0, 0};
-        curl_easy_setopt(handle(), CURLOPT_WRITEDATA, this);
-        curl_easy_setopt(handle(), CURLOPT_WRITEFUNCTION, write_static);
-        curl_easy_setopt(handle(), CURLOPT_READDATA, this);
-        curl_easy_setopt(handle(), CURLOPT_READFUNCTION, read_static);
-        curl_easy_setopt(handle(), CURLOPT_NOPROGRESS, 0L);
-        curl_easy_setopt(handle(), CURLOPT_PROGRESSDATA, this);
-        curl_easy_setopt(handle(), CURLOPT_XFERINFOFUNCTION, progress_static);
-        curl_easy_setopt(handle(), CURLOPT_URL, the_url.c_str());
-    };
+void Client::set_timeout(uint64_t t)
+{
+    m_impl->for_each_shard([t](ClientImpl &impl)
+                           {
+                               std::unique_lock<std::mutex> lock(impl.m_mutex);
+                               impl.m_timeout = t;
+                           });
+}
 
-    ///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
 
-    response_t &response() { return m_response; };
+double Client::progress_interval() const
+{
+    std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_progress_interval;
+}
 
-    ///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
 
-    bool perform()
-    {
-        CURLcode curlResult = curl_easy_perform(handle());
-        curl_easy_getinfo(handle(), CURLINFO_RESPONSE_CODE, &m_response.status_code);
-        m_response.duration = duration();
-        if(!curlResult && m_completion_handler) m_completion_handler(m_response);
-        return !curlResult;
-    }
+void Client::set_progress_interval(double secs)
+{
+    m_impl->for_each_shard([secs](ClientImpl &impl)
+                           {
+                               std::unique_lock<std::mutex> lock(impl.m_mutex);
+                               impl.m_progress_interval = secs;
+                           });
+}
 
-    ///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
 
-    [[nodiscard]] CURL *handle() const { return m_curl_handle.get(); }
+uint32_t Client::num_shards() const
+{
+    return static_cast<uint32_t>(m_impl->m_shards.size() + 1);
+}
 
-    ///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
 
-    [[nodiscard]] connection_info_t connection_info() const { return m_response.connection; }
+void Client::poll()
+{
+    m_impl->for_each_shard([](ClientImpl &impl)
+                           {
+                               if(!impl.m_io_running){ impl.poll(); }
+                           });
+}
 
-    ///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
 
-    [[nodiscard]] completion_cb_t completion_handler() const { return m_completion_handler; }
+void Client::start_io_thread(executor_t executor)
+{
+    m_impl->for_each_shard([&executor](ClientImpl &impl)
+                           {
+                               if(impl.m_io_running){ return; }
+                               impl.m_executor = executor;
+                               impl.m_io_running = true;
+                               impl.m_io_thread = std::thread([&impl]{ impl.run_io(); });
+                           });
+}
 
-    void set_completion_handler(completion_cb_t ch) { m_completion_handler = std::move(ch); }
+///////////////////////////////////////////////////////////////////////////////
 
-    void set_progress_handler(progress_cb_t ph) { m_progress_handler = std::move(ph); }
+void Client::stop_io_thread()
+{
+    m_impl->for_each_shard([](ClientImpl &impl)
+                           {
+                               if(!impl.m_io_running){ return; }
+                               impl.m_io_running = false;
+                               curl_multi_wakeup(impl.m_curl_multi_handle.get());
+                               if(impl.m_io_thread.joinable()){ impl.m_io_thread.join(); }
+                               impl.m_executor = {};
+                           });
+}
 
-    ///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
 
-    void set_timeout(uint64_t timeout)
-    {
-        m_response.connection.timeout = timeout;
-        curl_easy_setopt(handle(), CURLOPT_TIMEOUT, timeout);
-    }
+bool Client::io_thread_running() const
+{
+    return m_impl->m_io_running;
+}
 
-    ///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
 
-    [[nodiscard]] double duration() const
-    {
-        return duration_t(std::chrono::steady_clock::now() - m_start_time).count();
-    }
-};
+uint32_t Client::max_connections() const
+{
+    return m_impl->m_max_connections;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 
-using Action_GET = CurlAction;
+void Client::set_max_connections(uint32_t n)
+{
+    m_impl->for_each_shard([n](ClientImpl &impl)
+                           {
+                               std::unique_lock<std::mutex> lock(impl.m_mutex);
+                               impl.m_max_connections = n;
+                               impl.schedule_dispatch();
+                           });
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 
-class Action_POST : public CurlAction
+uint32_t Client::max_host_connections() const
 {
-private:
-    std::vector<uint8_t> m_data;
-    std::shared_ptr<struct curl_slist> m_headers;
+    return m_impl->m_max_host_connections;
+}
 
-public:
-    Action_POST(const std::string &the_url,
-                std::vector<uint8_t> the_data,
-                const std::string &the_mime_type) :
-            CurlAction(the_url),
-            m_data(std::move(the_data))
-    {
-        auto header_content = "Content-Type: " + the_mime_type;
-        m_headers = std::shared_ptr<struct curl_slist>(curl_slist_append(nullptr,
-                                                                         header_content.c_str()),
-                                                       curl_slist_free_all);
+///////////////////////////////////////////////////////////////////////////////
 
-        curl_easy_setopt(handle(), CURLOPT_URL, the_url.c_str());
-        curl_easy_setopt(handle(), CURLOPT_POSTFIELDS, &m_data[0]);
-        curl_easy_setopt(handle(), CURLOPT_POSTFIELDSIZE, static_cast<curl_off_t>(m_data.size()));
-        curl_easy_setopt(handle(), CURLOPT_HTTPHEADER, m_headers.get());
-    }
-};
+void Client::set_max_host_connections(uint32_t n)
+{
+    m_impl->for_each_shard([n](ClientImpl &impl)
+                           {
+                               std::unique_lock<std::mutex> lock(impl.m_mutex);
+                               impl.m_max_host_connections = n;
+                               impl.schedule_dispatch();
+                           });
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 
-class Action_PUT : public CurlAction
+rate_limit_t Client::rate_limit() const
 {
-private:
-    std::vector<uint8_t> m_data;
-    std::shared_ptr<struct curl_slist> m_headers;
+    std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_rate_limit;
+}
 
-public:
-    Action_PUT(const std::string &the_url,
-               std::vector<uint8_t> the_data,
-               const std::string &the_mime_type) :
-            CurlAction(the_url),
-            m_data(std::move(the_data))
-    {
-        auto header_content = "Content-Type: " + the_mime_type;
-        m_headers = std::shared_ptr<struct curl_slist>(curl_slist_append(nullptr,
-                                                                         header_content.c_str()),
-                                                       curl_slist_free_all);
+///////////////////////////////////////////////////////////////////////////////
 
-        curl_easy_setopt(handle(), CURLOPT_URL, the_url.c_str());
+void Client::set_rate_limit(const rate_limit_t &limit)
+{
+    // split evenly between shards
+    auto num_shards = static_cast<double>(m_impl->m_shards.size() + 1);
+    rate_limit_t share = {limit.rate / num_shards, std::max(limit.burst / num_shards, 1.0)};
+
+    m_impl->for_each_shard([&limit, &share](ClientImpl &impl)
+                           {
+                               std::unique_lock<std::mutex> lock(impl.m_mutex);
+                               impl.m_rate_limit = limit;
+                               impl.m_rate_limiter.configure(share, std::chrono::steady_clock::now());
+                               impl.schedule_dispatch();
+                           });
+}
 
-        /* enable uploading */
-        curl_easy_setopt(handle(), CURLOPT_UPLOAD, 1L);
+///////////////////////////////////////////////////////////////////////////////
 
-        /* HTTP PUT please */
-        curl_easy_setopt(handle(), CURLOPT_UPLOAD, 1L);
-        curl_easy_setopt(handle(), CURLOPT_INFILESIZE_LARGE, static_cast<curl_off_t>(m_data.size()));
-        curl_easy_setopt(handle(), CURLOPT_HTTPHEADER, m_headers.get());
-    }
-};
+rate_limit_t Client::host_rate_limit(const std::string &host) const
+{
+    auto &impl = m_impl->shard(host);
+    std::unique_lock<std::mutex> lock(impl.m_mutex);
+    auto itr = impl.m_host_rate_limiters.find(host);
+    return itr != impl.m_host_rate_limiters.end() ? itr->second.limit : rate_limit_t();
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 
-class Action_DELETE : public CurlAction
+void Client::set_host_rate_limit(const std::string &host, const rate_limit_t &limit)
 {
-public:
-    explicit Action_DELETE(const std::string &the_url) :
-            CurlAction(the_url)
+    auto &impl = m_impl->shard(host);
+    std::unique_lock<std::mutex> lock(impl.m_mutex);
+
+    if(limit.rate > 0.0){ impl.m_host_rate_limiters[host].configure(limit, std::chrono::steady_clock::now()); }
+    else
     {
-        curl_easy_setopt(handle(), CURLOPT_CUSTOMREQUEST, "DELETE");
+        // keep a pending Retry-After block
+        auto itr = impl.m_host_rate_limiters.find(host);
+        if(itr != impl.m_host_rate_limiters.end()){ itr->second.limit = {}; }
     }
-};
+    impl.schedule_dispatch();
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 
-response_t head(const std::string &url)
+retry_policy_t Client::retry_policy() const
 {
-    ActionPtr url_action = std::make_unique<Action_GET>(url);
-    curl_easy_setopt(url_action->handle(), CURLOPT_NOBODY, 1L);
-    url_action->perform();
-    return url_action->response();
+    std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_retry_policy;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-response_t get(const std::string &url)
+void Client::set_retry_policy(const retry_policy_t &policy)
 {
-    ActionPtr url_action = std::make_unique<Action_GET>(url);
-    url_action->perform();
-    return url_action->response();
+    m_impl->for_each_shard([&policy](ClientImpl &impl)
+                           {
+                               std::unique_lock<std::mutex> lock(impl.m_mutex);
+                               impl.m_retry_policy = policy;
+                           });
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-response_t post(const std::string &url,
-                const std::vector<uint8_t> &data,
-                const std::string &mime_type)
+hedge_policy_t Client::hedge_policy() const
 {
-    ActionPtr url_action = std::make_shared<Action_POST>(url, data, mime_type);
-    url_action->perform();
-    return url_action->response();
+    std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_hedge_policy;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-response_t put(const std::string &url,
-               const std::vector<uint8_t> &data,
-               const std::string &mime_type)
+void Client::set_hedge_policy(const hedge_policy_t &policy)
 {
-    ActionPtr url_action = std::make_shared<Action_PUT>(url, data, mime_type);
-    url_action->perform();
-    return url_action->response();
+    m_impl->for_each_shard([&policy](ClientImpl &impl)
+                           {
+                               std::unique_lock<std::mutex> lock(impl.m_mutex);
+                               impl.m_hedge_policy = policy;
+                               impl.m_hedge_delay = 0.0;
+                           });
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-response_t del(const std::string &url)
+CachePtr Client::cache() const
 {
-    ActionPtr url_action = std::make_shared<Action_DELETE>(url);
-    url_action->perform();
-    return url_action->response();
+    std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_cache;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-Client::Client() :
-        m_impl(std::make_unique<ClientImpl>())
+void Client::set_cache(CachePtr cache)
 {
-
+    m_impl->for_each_shard([&cache](ClientImpl &impl)
+                           {
+                               std::unique_lock<std::mutex> lock(impl.m_mutex);
+                               impl.m_cache = cache;
+                           });
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-Client &Client::operator=(Client other)
+bool Client::coalesce_requests() const
 {
-    std::swap(m_impl, other.m_impl);
-    return *this;
+    std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_coalesce;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void ClientImpl::poll()
+void Client::set_coalesce_requests(bool b)
 {
-    curl_multi_perform(m_curl_multi_handle.get(), &m_num_connections);
-    int msgs_left;
-    CURLMsg *msg = curl_multi_info_read(m_curl_multi_handle.get(), &msgs_left);
-
-    while(msg)
-    {
-        if(msg->msg == CURLMSG_DONE)
-        {
-            std::unique_lock<std::mutex> lock(m_mutex);
-            CURL *easy = msg->easy_handle;
-            CURLcode res = msg->data.result;
-            curl_multi_remove_handle(m_curl_multi_handle.get(), easy);
-            auto itr = m_handle_map.find(easy);
-
-            if(itr != m_handle_map.end())
-            {
-                auto &response = itr->second->response();
-                response.duration = itr->second->duration();
-
-                if(!res)
-                {
-                    // http response code
-                    curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &itr->second->response().status_code);
-                    auto ci = itr->second->connection_info();
-                    if(itr->second->completion_handler()){ itr->second->completion_handler()(response); }
-                }else
-                {
-                    // TODO: error callback!?
-                }
-                m_handle_map.erase(itr);
-            }
-        }
-        msg = curl_multi_info_read(m_curl_multi_handle.get(), &msgs_left);
-    }
+    m_impl->for_each_shard([b](ClientImpl &impl)
+                           {
+                               std::unique_lock<std::mutex> lock(impl.m_mutex);
+                               impl.m_coalesce = b;
+                           });
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void ClientImpl::add_action(const ActionPtr &action, completion_cb_t ch, progress_cb_t ph)
+void Client::add_hot_origin(const hot_origin_t &hot_origin)
 {
-    // set options for this handle
-    action->set_timeout(m_timeout);
-    action->set_completion_handler(std::move(ch));
-    action->set_progress_handler(std::move(ph));
-
-    std::unique_lock<std::mutex> lock(m_mutex);
-    m_handle_map[action->handle()] = action;
-
-    // add handle to multi
-    curl_multi_add_handle(m_curl_multi_handle.get(), action->handle());
-
-//    if(m_io_service && !m_num_connections)
-//    {
-//        m_io_service->post([this] { poll(); });
-//    }
+    auto &impl = m_impl->shard(hot_origin.origin);
+    std::unique_lock<std::mutex> lock(impl.m_mutex);
+    auto &state = impl.m_hot_origins[hot_origin.origin];
+    state.config = hot_origin;
+    state.host = host_from_url(hot_origin.origin);
+    state.due = std::chrono::steady_clock::now();
+    impl.schedule_dispatch();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void Client::async_head(const std::string &url,
-                        completion_cb_t ch,
-                        progress_cb_t ph)
+void Client::remove_hot_origin(const std::string &origin)
 {
-    ActionPtr url_action = std::make_shared<Action_GET>(url);
-    curl_easy_setopt(url_action->handle(), CURLOPT_NOBODY, 1L);
-    m_impl->add_action(url_action, std::move(ch), std::move(ph));
+    auto &impl = m_impl->shard(origin);
+    std::unique_lock<std::mutex> lock(impl.m_mutex);
+    impl.m_hot_origins.erase(origin);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void Client::async_get(const std::string &url,
-                       completion_cb_t completion_cb,
-                       progress_cb_t ph)
+std::vector<hot_origin_t> Client::hot_origins() const
 {
-    // create an action which holds an easy handle
-    ActionPtr url_action = std::make_shared<Action_GET>(url);
-    m_impl->add_action(url_action, std::move(completion_cb), std::move(ph));
+    std::vector<hot_origin_t> ret;
+    m_impl->for_each_shard([&ret](ClientImpl &impl)
+                           {
+                               std::unique_lock<std::mutex> lock(impl.m_mutex);
+                               for(const auto &[origin, state]: impl.m_hot_origins){ ret.push_back(state.config); }
+                           });
+    return ret;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void Client::async_post(const std::string &url,
-                        const std::vector<uint8_t> &data,
-                        completion_cb_t completion_cb,
-                        const std::string &mime_type,
-                        progress_cb_t progress_cb)
+queue_stats_t Client::queue_stats() const
 {
-    ActionPtr url_action = std::make_shared<Action_POST>(url, data, mime_type);
-    m_impl->add_action(url_action, std::move(completion_cb), std::move(progress_cb));
+    queue_stats_t ret;
+    double total_wait = 0.0;
+
+    m_impl->for_each_shard([&ret, &total_wait](ClientImpl &impl)
+                           {
+                               std::unique_lock<std::mutex> lock(impl.m_mutex);
+                               const auto &stats = impl.m_queue_stats;
+                               ret.num_queued += impl.m_queue.size();
+                               ret.num_in_flight += impl.m_handle_map.size();
+                               ret.max_queue_depth = std::max(ret.max_queue_depth, stats.max_queue_depth);
+                               ret.num_dispatched += stats.num_dispatched;
+                               ret.num_coalesced += stats.num_coalesced;
+                               ret.num_retries += stats.num_retries;
+                               ret.num_hedges += stats.num_hedges;
+                               ret.num_errors += stats.num_errors;
+                               ret.num_warmups += stats.num_warmups;
+                               ret.num_throttled += stats.num_throttled;
+                               ret.max_wait = std::max(ret.max_wait, stats.max_wait);
+                               total_wait += impl.m_total_wait;
+                           });
+    if(ret.num_dispatched){ ret.mean_wait = total_wait / static_cast<double>(ret.num_dispatched); }
+    return ret;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void Client::async_put(const std::string &url,
-                       const std::vector<uint8_t> &data,
-                       completion_cb_t completion_cb,
-                       const std::string &mime_type,
-                       progress_cb_t progress_cb)
+compression_policy_t Client::compression_policy() const
 {
-    ActionPtr url_action = std::make_shared<Action_PUT>(url, data, mime_type);
-    m_impl->add_action(url_action, std::move(completion_cb), std::move(progress_cb));
+    std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_compression_policy;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void Client::async_del(const std::string &url, completion_cb_t completion_cb)
+void Client::set_compression_policy(const compression_policy_t &policy)
 {
-    ActionPtr url_action = std::make_shared<Action_DELETE>(url);
-    m_impl->add_action(url_action, std::move(completion_cb));
+    m_impl->for_each_shard([&policy](ClientImpl &impl)
+                           {
+                               std::unique_lock<std::mutex> lock(impl.m_mutex);
+                               impl.m_compression_policy = policy;
+                           });
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-uint64_t Client::timeout() const
+compression_stats_t Client::compression_stats() const
 {
-    return m_impl->m_timeout;
+    compression_stats_t ret;
+
+    m_impl->for_each_shard([&ret](ClientImpl &impl)
+                           {
+                               std::unique_lock<std::mutex> lock(impl.m_mutex);
+                               const auto &stats = impl.m_compression_stats;
+                               ret.num_bytes_raw += stats.num_bytes_raw;
+                               ret.num_bytes_sent += stats.num_bytes_sent;
+                               ret.num_bytes_received += stats.num_bytes_received;
+                               ret.num_bytes_decoded += stats.num_bytes_decoded;
+                               ret.encode_time += stats.encode_time;
+                               ret.decode_time += stats.decode_time;
+                           });
+    if(ret.num_bytes_received){ ret.response_ratio = double(ret.num_bytes_decoded) / double(ret.num_bytes_received); }
+    if(ret.num_bytes_sent){ ret.request_ratio = double(ret.num_bytes_raw) / double(ret.num_bytes_sent); }
+    return ret;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void Client::set_timeout(uint64_t t)
+std::map<std::string, host_stats_t> Client::host_stats() const
 {
-    m_impl->m_timeout = t;
+    std::map<std::string, host_stats_t> ret;
+
+    m_impl->for_each_shard([&ret](ClientImpl &impl)
+                           {
+                               std::unique_lock<std::mutex> lock(impl.m_mutex);
+
+                               for(const auto &[host, stats]: impl.m_host_stats)
+                               {
+                                   auto &dst = ret[host];
+                                   dst.num_requests += stats.num_requests;
+                                   dst.num_reused_connections += stats.num_reused_connections;
+                                   dst.dns.merge(stats.dns);
+                                   dst.connect.merge(stats.connect);
+                                   dst.tls.merge(stats.tls);
+                                   dst.ttfb.merge(stats.ttfb);
+                                   dst.total.merge(stats.total);
+                               }
+                           });
+    return ret;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void Client::poll() { m_impl->poll(); }
+void Client::reset_host_stats()
+{
+    m_impl->for_each_shard([](ClientImpl &impl)
+                           {
+                               std::unique_lock<std::mutex> lock(impl.m_mutex);
+                               impl.m_host_stats.clear();
+                           });
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 
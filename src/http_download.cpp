@@ -0,0 +1,495 @@
+#include <curl/curl.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include "netzer/http.hpp"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace netzer::http
+{
+
+namespace
+{
+
+using duration_t = std::chrono::duration<double>;
+using easy_handle_t = std::unique_ptr<CURL, decltype(&curl_easy_cleanup)>;
+
+/*!
+ * read-write memory-mapping of an entire file with fixed size
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile(){ close(); }
+
+    /*!
+     * open or create the file at <path>, resize it to <size> bytes and map it into memory.
+     * existing content within <size> is preserved.
+     */
+    bool open(const std::string &path, uint64_t size)
+    {
+        close();
+#if defined(_WIN32)
+        m_file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS,
+                             FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(m_file == INVALID_HANDLE_VALUE){ return false; }
+        LARGE_INTEGER file_size;
+        file_size.QuadPart = static_cast<LONGLONG>(size);
+
+        if(!SetFilePointerEx(m_file, file_size, nullptr, FILE_BEGIN) || !SetEndOfFile(m_file))
+        {
+            close();
+            return false;
+        }
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READWRITE, static_cast<DWORD>(file_size.HighPart),
+                                       file_size.LowPart, nullptr);
+        if(!m_mapping){ close(); return false; }
+        m_data = static_cast<uint8_t *>(MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+        if(!m_data){ close(); return false; }
+#else
+        m_fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if(m_fd < 0){ return false; }
+        if(ftruncate(m_fd, static_cast<off_t>(size))){ close(); return false; }
+        void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if(ptr == MAP_FAILED){ close(); return false; }
+        m_data = static_cast<uint8_t *>(ptr);
+#endif
+        m_size = size;
+        return true;
+    }
+
+    /*!
+     * write back a modified range to disk (blocking)
+     */
+    bool flush(uint64_t offset, uint64_t num_bytes)
+    {
+        if(!m_data){ return false; }
+#if defined(_WIN32)
+        return FlushViewOfFile(m_data + offset, static_cast<SIZE_T>(num_bytes));
+#else
+        // msync requires a page-aligned address
+        static const auto page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        uint64_t aligned_offset = offset - offset % page_size;
+        return !msync(m_data + aligned_offset, num_bytes + offset - aligned_offset, MS_SYNC);
+#endif
+    }
+
+    void close()
+    {
+#if defined(_WIN32)
+        if(m_data){ UnmapViewOfFile(m_data); }
+        if(m_mapping){ CloseHandle(m_mapping); }
+        if(m_file != INVALID_HANDLE_VALUE){ CloseHandle(m_file); }
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+#else
+        if(m_data){ munmap(m_data, m_size); }
+        if(m_fd >= 0){ ::close(m_fd); }
+        m_fd = -1;
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    [[nodiscard]] uint8_t *data() const{ return m_data; }
+
+private:
+#if defined(_WIN32)
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+    uint8_t *m_data = nullptr;
+    uint64_t m_size = 0;
+};
+
+//! persistent progress of a ranged download, stored in <path>.part
+struct download_state_t
+{
+    uint64_t size = 0;
+    uint64_t chunk_size = 0;
+
+    // ETag or Last-Modified of the resource
+    std::string validator;
+
+    // one character per chunk, '1' for completed chunks
+    std::string chunks;
+};
+
+constexpr char g_state_magic[] = "netzer-download 1";
+
+bool load_state(const std::string &path, download_state_t &state)
+{
+    std::ifstream in(path);
+    std::string magic;
+    if(!std::getline(in, magic) || magic != g_state_magic){ return false; }
+    if(!(in >> state.size >> state.chunk_size)){ return false; }
+    in.ignore(1);
+    return std::getline(in, state.validator) && std::getline(in, state.chunks);
+}
+
+/*!
+ * write the state to a temporary file first, so an interruption never leaves a corrupt state
+ */
+bool save_state(const std::string &path, const download_state_t &state)
+{
+    auto tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::trunc);
+        out << g_state_magic << "\n" << state.size << " " << state.chunk_size << "\n"
+            << state.validator << "\n" << state.chunks << "\n";
+        if(!out.flush()){ return false; }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    return !ec;
+}
+
+//! metadata of a resource, queried with HEAD
+struct resource_info_t
+{
+    long status = 0;
+    int64_t size = -1;
+    bool accept_ranges = false;
+    std::string validator, effective_url;
+};
+
+size_t head_header_static(char *buffer, size_t size, size_t nitems, void *userp)
+{
+    auto *info = static_cast<resource_info_t *>(userp);
+    std::string line(buffer, size * nitems);
+    std::transform(line.begin(), line.end(), line.begin(), [](unsigned char c){ return std::tolower(c); });
+
+    // headers of a redirect are discarded
+    if(line.rfind("http/", 0) == 0)
+    {
+        info->accept_ranges = false;
+        info->validator.clear();
+    }
+    else if(line.rfind("accept-ranges:", 0) == 0)
+    {
+        info->accept_ranges = line.find("bytes") != std::string::npos;
+    }
+    else if(line.rfind("etag:", 0) == 0 || (line.rfind("last-modified:", 0) == 0 && info->validator.empty()))
+    {
+        // keep original case for validators
+        std::string value(buffer + line.find(':') + 1, size * nitems - line.find(':') - 1);
+        auto begin = value.find_first_not_of(" \t");
+        auto end = value.find_last_not_of(" \t\r\n");
+        info->validator = begin == std::string::npos ? std::string() : value.substr(begin, end - begin + 1);
+    }
+    return size * nitems;
+}
+
+void setup_handle(CURL *handle, const std::string &url, const download_options_t &options)
+{
+    curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(handle, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+    if(options.timeout){ curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT_MS, static_cast<long>(options.timeout)); }
+}
+
+//! a running transfer for a single byte-range
+struct transfer_t
+{
+    easy_handle_t handle{curl_easy_init(), curl_easy_cleanup};
+    size_t chunk = 0;
+
+    // destination within the mapped file
+    uint8_t *dst = nullptr;
+    uint64_t offset = 0, num_bytes = 0, num_written = 0;
+
+    std::string range;
+    char error_buffer[CURL_ERROR_SIZE] = {};
+};
+
+size_t range_write_static(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+    auto *transfer = static_cast<transfer_t *>(userp);
+    size_t num_bytes = size * nmemb;
+
+    // more data than requested, i.e. the range was ignored -> abort
+    if(transfer->num_written + num_bytes > transfer->num_bytes){ return 0; }
+    memcpy(transfer->dst + transfer->num_written, ptr, num_bytes);
+    transfer->num_written += num_bytes;
+    return num_bytes;
+}
+
+size_t file_write_static(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+    return fwrite(ptr, size, nmemb, static_cast<FILE *>(userp)) * size;
+}
+
+/*!
+ * fallback for resources with unknown size: a single GET, streamed into the file
+ */
+void stream_download(const std::string &url, const std::string &path, const download_options_t &options,
+                     const progress_cb_t &progress_cb, download_result_t &result)
+{
+    std::unique_ptr<FILE, decltype(&fclose)> file(fopen(path.c_str(), "wb"), fclose);
+    if(!file){ result.error = "could not open file: " + path; return; }
+
+    easy_handle_t handle(curl_easy_init(), curl_easy_cleanup);
+    char error_buffer[CURL_ERROR_SIZE] = {};
+    setup_handle(handle.get(), url, options);
+    curl_easy_setopt(handle.get(), CURLOPT_WRITEFUNCTION, file_write_static);
+    curl_easy_setopt(handle.get(), CURLOPT_WRITEDATA, file.get());
+    curl_easy_setopt(handle.get(), CURLOPT_ERRORBUFFER, error_buffer);
+
+    using progress_t = std::pair<const std::string *, const progress_cb_t *>;
+    progress_t progress_data = {&url, &progress_cb};
+
+    if(progress_cb)
+    {
+        auto xferinfo = [](void *userp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t, curl_off_t) -> int
+        {
+            auto *data = static_cast<progress_t *>(userp);
+            connection_info_t info;
+            info.url = *data->first;
+            info.dl_total = static_cast<double>(dltotal);
+            info.dl_now = static_cast<double>(dlnow);
+            (*data->second)(info);
+            return 0;
+        };
+        curl_easy_setopt(handle.get(), CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(handle.get(), CURLOPT_XFERINFODATA, &progress_data);
+        curl_easy_setopt(handle.get(), CURLOPT_XFERINFOFUNCTION, +xferinfo);
+    }
+    CURLcode res = curl_easy_perform(handle.get());
+
+    if(res){ result.error = error_buffer[0] ? error_buffer : curl_easy_strerror(res); }
+    else
+    {
+        curl_off_t num_bytes = 0;
+        curl_easy_getinfo(handle.get(), CURLINFO_SIZE_DOWNLOAD_T, &num_bytes);
+        result.num_bytes = static_cast<uint64_t>(num_bytes);
+        result.success = true;
+    }
+}
+
+}// namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+download_result_t download(const std::string &url,
+                           const std::string &path,
+                           const download_options_t &options,
+                           const progress_cb_t &progress_cb)
+{
+    download_result_t result;
+    auto start_time = std::chrono::steady_clock::now();
+    auto state_path = path + ".part";
+
+    // query size, support for byte-ranges and validators
+    resource_info_t info;
+    {
+        easy_handle_t handle(curl_easy_init(), curl_easy_cleanup);
+        setup_handle(handle.get(), url, options);
+        curl_easy_setopt(handle.get(), CURLOPT_NOBODY, 1L);
+        curl_easy_setopt(handle.get(), CURLOPT_HEADERFUNCTION, head_header_static);
+        curl_easy_setopt(handle.get(), CURLOPT_HEADERDATA, &info);
+
+        if(!curl_easy_perform(handle.get()))
+        {
+            curl_off_t size = -1;
+            char *effective_url = nullptr;
+            curl_easy_getinfo(handle.get(), CURLINFO_RESPONSE_CODE, &info.status);
+            curl_easy_getinfo(handle.get(), CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &size);
+            curl_easy_getinfo(handle.get(), CURLINFO_EFFECTIVE_URL, &effective_url);
+            info.size = size;
+            if(effective_url){ info.effective_url = effective_url; }
+        }
+    }
+
+    // size unknown or HEAD not supported
+    if(info.status / 100 != 2 || info.size < 0)
+    {
+        stream_download(url, path, options, progress_cb, result);
+        result.duration = duration_t(std::chrono::steady_clock::now() - start_time).count();
+        return result;
+    }
+    auto size = static_cast<uint64_t>(info.size);
+    result.num_bytes = size;
+
+    if(!size)
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if(!out){ result.error = "could not open file: " + path; }
+        else
+        {
+            std::error_code ec;
+            std::filesystem::remove(state_path, ec);
+            result.success = true;
+        }
+        result.duration = duration_t(std::chrono::steady_clock::now() - start_time).count();
+        return result;
+    }
+
+    // without byte-ranges, a single transfer fetches the entire resource
+    bool ranged = info.accept_ranges;
+    uint64_t chunk_size = ranged ? std::max<uint64_t>(options.chunk_size, 1) : size;
+    auto num_chunks = static_cast<size_t>((size + chunk_size - 1) / chunk_size);
+
+    download_state_t state;
+    std::error_code ec;
+    bool resumed = options.resume && ranged && !info.validator.empty() &&
+                   load_state(state_path, state) && state.size == size && state.chunk_size == chunk_size &&
+                   state.validator == info.validator && state.chunks.size() == num_chunks &&
+                   std::filesystem::file_size(path, ec) == size && !ec;
+
+    if(!resumed)
+    {
+        state.size = size;
+        state.chunk_size = chunk_size;
+        state.validator = info.validator;
+        state.chunks.assign(num_chunks, '0');
+    }
+
+    MappedFile file;
+    if(!file.open(path, size))
+    {
+        result.error = "could not map file: " + path;
+        return result;
+    }
+
+    // persist state, only ranged downloads with a validator can be resumed
+    bool persist = ranged && !info.validator.empty();
+    if(persist){ save_state(state_path, state); }
+
+    std::deque<size_t> pending;
+    uint64_t num_bytes_done = 0;
+
+    for(size_t i = 0; i < num_chunks; ++i)
+    {
+        if(state.chunks[i] == '1'){ num_bytes_done += std::min(chunk_size, size - i * chunk_size); }
+        else{ pending.push_back(i); }
+    }
+    result.num_bytes_resumed = num_bytes_done;
+
+    const auto &transfer_url = info.effective_url.empty() ? url : info.effective_url;
+    std::unique_ptr<CURLM, decltype(&curl_multi_cleanup)> multi(curl_multi_init(), curl_multi_cleanup);
+    std::map<CURL *, std::unique_ptr<transfer_t>> active;
+    std::vector<uint32_t> attempts(num_chunks, 0);
+    double last_progress = -1.0;
+
+    auto start_transfer = [&](size_t chunk)
+    {
+        auto transfer = std::make_unique<transfer_t>();
+        transfer->chunk = chunk;
+        transfer->offset = chunk * chunk_size;
+        transfer->num_bytes = std::min(chunk_size, size - transfer->offset);
+        transfer->dst = file.data() + transfer->offset;
+        CURL *handle = transfer->handle.get();
+        setup_handle(handle, transfer_url, options);
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, range_write_static);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, transfer.get());
+        curl_easy_setopt(handle, CURLOPT_ERRORBUFFER, transfer->error_buffer);
+
+        if(ranged)
+        {
+            transfer->range = std::to_string(transfer->offset) + "-" +
+                              std::to_string(transfer->offset + transfer->num_bytes - 1);
+            curl_easy_setopt(handle, CURLOPT_RANGE, transfer->range.c_str());
+        }
+        curl_multi_add_handle(multi.get(), handle);
+        active[handle] = std::move(transfer);
+    };
+
+    while((!pending.empty() || !active.empty()) && result.error.empty())
+    {
+        while(active.size() < std::max<uint32_t>(options.num_connections, 1) && !pending.empty())
+        {
+            start_transfer(pending.front());
+            pending.pop_front();
+        }
+        int num_running = 0;
+        curl_multi_perform(multi.get(), &num_running);
+        int msgs_left;
+
+        while(CURLMsg *msg = curl_multi_info_read(multi.get(), &msgs_left))
+        {
+            if(msg->msg != CURLMSG_DONE){ continue; }
+            auto itr = active.find(msg->easy_handle);
+            if(itr == active.end()){ continue; }
+            auto transfer = std::move(itr->second);
+            active.erase(itr);
+            curl_multi_remove_handle(multi.get(), transfer->handle.get());
+
+            long status = 0;
+            curl_easy_getinfo(transfer->handle.get(), CURLINFO_RESPONSE_CODE, &status);
+            bool success = !msg->data.result && transfer->num_written == transfer->num_bytes &&
+                           (ranged ? status == 206 : status / 100 == 2);
+
+            if(success)
+            {
+                // data needs to be on disk, before the chunk is marked as done
+                file.flush(transfer->offset, transfer->num_bytes);
+                state.chunks[transfer->chunk] = '1';
+                num_bytes_done += transfer->num_bytes;
+                if(persist){ save_state(state_path, state); }
+            }
+            else if(++attempts[transfer->chunk] < std::max<uint32_t>(options.max_attempts, 1))
+            {
+                pending.push_back(transfer->chunk);
+            }
+            else if(msg->data.result)
+            {
+                result.error = transfer->error_buffer[0] ? transfer->error_buffer
+                                                         : curl_easy_strerror(msg->data.result);
+            }
+            else{ result.error = "unexpected response for range " + transfer->range + ": " + std::to_string(status); }
+        }
+
+        if(progress_cb)
+        {
+            uint64_t num_bytes_now = num_bytes_done;
+            for(const auto &[handle, transfer]: active){ num_bytes_now += transfer->num_written; }
+
+            if(static_cast<double>(num_bytes_now) != last_progress)
+            {
+                last_progress = static_cast<double>(num_bytes_now);
+                connection_info_t progress;
+                progress.url = url;
+                progress.dl_total = static_cast<double>(size);
+                progress.dl_now = last_progress;
+                progress.timeout = options.timeout;
+                progress_cb(progress);
+            }
+        }
+        if(!active.empty()){ curl_multi_poll(multi.get(), nullptr, 0, 100, nullptr); }
+    }
+
+    // abort remaining transfers on error
+    for(const auto &[handle, transfer]: active){ curl_multi_remove_handle(multi.get(), handle); }
+    active.clear();
+    file.close();
+
+    result.success = result.error.empty();
+
+    // keep the state for a later resume, unless finished
+    if(result.success){ std::filesystem::remove(state_path, ec); }
+    result.duration = duration_t(std::chrono::steady_clock::now() - start_time).count();
+    return result;
+}
+
+}// namespace
@@ -0,0 +1,483 @@
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <algorithm>
+#include <charconv>
+#include "netzer/http_server.hpp"
+#include "netzer/trace.hpp"
+
+namespace netzer::http
+{
+
+namespace
+{
+
+// limit for request-line and headers
+constexpr size_t g_max_header_size = 64 * (1 << 10);
+
+bool iequals(std::string_view lhs, std::string_view rhs)
+{
+    return lhs.size() == rhs.size() &&
+           std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](char a, char b)
+           {
+               return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+           });
+}
+
+bool icontains(std::string_view str, std::string_view token)
+{
+    if(token.size() > str.size()){ return false; }
+
+    for(size_t i = 0; i + token.size() <= str.size(); ++i)
+    {
+        if(iequals(str.substr(i, token.size()), token)){ return true; }
+    }
+    return false;
+}
+
+std::string_view trim(std::string_view str)
+{
+    auto begin = str.find_first_not_of(" \t");
+    if(begin == std::string_view::npos){ return {}; }
+    auto end = str.find_last_not_of(" \t");
+    return str.substr(begin, end - begin + 1);
+}
+
+const char *reason_phrase(uint16_t status)
+{
+    switch(status)
+    {
+        case 100: return "Continue";
+        case 200: return "OK";
+        case 201: return "Created";
+        case 202: return "Accepted";
+        case 204: return "No Content";
+        case 301: return "Moved Permanently";
+        case 302: return "Found";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
+        case 411: return "Length Required";
+        case 413: return "Payload Too Large";
+        case 429: return "Too Many Requests";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+        case 504: return "Gateway Timeout";
+        default: return "Unknown";
+    }
+}
+
+/*!
+ * parse request-line and headers. <head> excludes the terminating empty line.
+ */
+bool parse_head(std::string_view head, server_request_t &request)
+{
+    auto line_end = head.find("\r\n");
+    auto request_line = head.substr(0, line_end);
+
+    auto method_end = request_line.find(' ');
+    if(method_end == std::string_view::npos){ return false; }
+    auto target_end = request_line.find(' ', method_end + 1);
+    if(target_end == std::string_view::npos){ return false; }
+
+    request.method = request_line.substr(0, method_end);
+    request.target = request_line.substr(method_end + 1, target_end - method_end - 1);
+    request.version = request_line.substr(target_end + 1);
+    if(request.method.empty() || request.target.empty() || !request.version.starts_with("HTTP/")){ return false; }
+
+    auto query_pos = request.target.find('?');
+    request.path = request.target.substr(0, query_pos);
+    request.query = query_pos == std::string_view::npos ? std::string_view() : request.target.substr(query_pos + 1);
+
+    request.headers.clear();
+
+    while(line_end != std::string_view::npos && line_end + 2 < head.size())
+    {
+        auto line_start = line_end + 2;
+        line_end = head.find("\r\n", line_start);
+        auto line = head.substr(line_start, line_end == std::string_view::npos ? line_end : line_end - line_start);
+        auto colon_pos = line.find(':');
+        if(colon_pos == std::string_view::npos || !colon_pos){ return false; }
+        request.headers.emplace_back(line.substr(0, colon_pos), trim(line.substr(colon_pos + 1)));
+    }
+
+    auto connection = request.header("connection");
+    request.keep_alive = request.version == "HTTP/1.0" ? icontains(connection, "keep-alive")
+                                                       : !icontains(connection, "close");
+    return true;
+}
+
+std::vector<uint8_t> serialize_head(const server_request_t &request, const server_response_t &response)
+{
+    std::string head;
+    head.reserve(256);
+    head.append("HTTP/1.1 ").append(std::to_string(response.status)).append(" ");
+    head.append(reason_phrase(response.status)).append("\r\n");
+    bool has_content_length = false;
+
+    for(const auto &[key, value]: response.headers)
+    {
+        has_content_length = has_content_length || iequals(key, "content-length");
+        head.append(key).append(": ").append(value).append("\r\n");
+    }
+    if(!has_content_length){ head.append("Content-Length: ").append(std::to_string(response.body.size())).append("\r\n"); }
+    if(!request.keep_alive){ head.append("Connection: close\r\n"); }
+    else if(request.version == "HTTP/1.0"){ head.append("Connection: keep-alive\r\n"); }
+    head.append("\r\n");
+    return {head.begin(), head.end()};
+}
+
+}// namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::string_view server_request_t::header(std::string_view name) const
+{
+    for(const auto &[key, value]: headers)
+    {
+        if(iequals(key, name)){ return value; }
+    }
+    return {};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct ServerImpl : public std::enable_shared_from_this<ServerImpl>
+{
+    struct route_t
+    {
+        std::string method, path;
+        bool prefix = false;
+        request_handler_t handler;
+    };
+
+    struct session_t
+    {
+        tcp_connection_ptr connection;
+
+        // received bytes, not yet consumed by complete requests
+        std::vector<uint8_t> buffer;
+
+        // offset to resume the search for the end of headers
+        size_t scan_offset = 0;
+
+        // size of a pending request with complete headers, but incomplete body
+        size_t pending_size = 0;
+
+        // reused for all requests on this connection
+        server_request_t request;
+        server_response_t response;
+
+        bool continue_sent = false;
+        bool closing = false;
+    };
+    using session_ptr = std::shared_ptr<session_t>;
+
+    tcp_server server;
+    std::vector<route_t> routes;
+    request_handler_t default_handler;
+    std::atomic<size_t> max_body_size{Server::DEFAULT_MAX_BODY_SIZE};
+
+    std::unordered_map<tcp_connection *, session_ptr> sessions;
+    server_stats_t stats;
+    mutable std::mutex mutex;
+
+    explicit ServerImpl(io_service_t &io_service) : server(io_service){}
+
+    void on_connect(const tcp_connection_ptr &connection)
+    {
+        auto session = std::make_shared<session_t>();
+        session->connection = connection;
+        std::weak_ptr<ServerImpl> weak_self = shared_from_this();
+        std::weak_ptr<session_t> weak_session = session;
+
+        connection->set_tcp_receive_cb([weak_self, weak_session](const tcp_connection_ptr &, std::vector<uint8_t> data)
+                                       {
+                                           auto self = weak_self.lock();
+                                           auto session = weak_session.lock();
+                                           if(self && session){ self->on_receive(session, data); }
+                                       });
+        connection->set_disconnect_cb([weak_self](const ConnectionPtr &con)
+                                      {
+                                          auto self = weak_self.lock();
+                                          if(!self){ return; }
+                                          std::unique_lock<std::mutex> lock(self->mutex);
+                                          self->sessions.erase(static_cast<tcp_connection *>(con.get()));
+                                      });
+        std::unique_lock<std::mutex> lock(mutex);
+        sessions[connection.get()] = std::move(session);
+        stats.num_connections++;
+    }
+
+    void on_receive(const session_ptr &session, const std::vector<uint8_t> &data)
+    {
+        if(session->closing){ return; }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stats.num_bytes_received += data.size();
+        }
+        auto &buffer = session->buffer;
+        buffer.insert(buffer.end(), data.begin(), data.end());
+        size_t offset = 0;
+
+        // process all complete requests (pipelining)
+        while(!session->closing && offset < buffer.size())
+        {
+            std::string_view view(reinterpret_cast<const char *>(buffer.data()) + offset, buffer.size() - offset);
+
+            // headers were parsed before, body still incomplete
+            if(session->pending_size && view.size() < session->pending_size){ break; }
+
+            auto header_end = view.find("\r\n\r\n", session->scan_offset);
+
+            if(header_end == std::string_view::npos)
+            {
+                if(view.size() > g_max_header_size){ send_error(session, 431); }
+
+                // the terminator might be split across receives
+                else{ session->scan_offset = view.size() >= 3 ? view.size() - 3 : 0; }
+                break;
+            }
+            auto &request = session->request;
+
+            if(!parse_head(view.substr(0, header_end + 2), request))
+            {
+                send_error(session, 400);
+                break;
+            }
+            if(!request.header("transfer-encoding").empty() && !iequals(request.header("transfer-encoding"), "identity"))
+            {
+                send_error(session, 501);
+                break;
+            }
+            size_t content_length = 0;
+            auto content_length_str = request.header("content-length");
+
+            if(!content_length_str.empty())
+            {
+                auto [ptr, ec] = std::from_chars(content_length_str.data(),
+                                                 content_length_str.data() + content_length_str.size(),
+                                                 content_length);
+                if(ec != std::errc()){ send_error(session, 400); break; }
+            }
+            if(content_length > max_body_size)
+            {
+                send_error(session, 413);
+                break;
+            }
+            size_t request_size = header_end + 4 + content_length;
+
+            if(view.size() < request_size)
+            {
+                session->pending_size = request_size;
+                session->scan_offset = header_end;
+
+                if(!session->continue_sent && iequals(request.header("expect"), "100-continue"))
+                {
+                    session->continue_sent = true;
+                    std::string str = "HTTP/1.1 100 Continue\r\n\r\n";
+                    session->connection->write_buffers({std::vector<uint8_t>(str.begin(), str.end())});
+                }
+                break;
+            }
+            request.body = view.substr(header_end + 4, content_length);
+            handle(session);
+
+            offset += request_size;
+            session->scan_offset = session->pending_size = 0;
+            session->continue_sent = false;
+        }
+
+        // discard consumed requests at once
+        buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(std::min(offset, buffer.size())));
+    }
+
+    void handle(const session_ptr &session)
+    {
+        auto &request = session->request;
+        auto &response = session->response;
+        response.status = 200;
+        response.headers.clear();
+        response.body.clear();
+
+        // copied while locked, routes might be added concurrently
+        request_handler_t handler;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stats.num_requests++;
+            const route_t *route = nullptr;
+
+            for(const auto &r: routes)
+            {
+                if(!r.method.empty() && r.method != request.method){ continue; }
+
+                if(r.prefix ? request.path.starts_with(r.path) : request.path == r.path)
+                {
+                    // exact matches and longer prefixes take precedence
+                    if(!route || (route->prefix && (!r.prefix || r.path.size() > route->path.size()))){ route = &r; }
+                }
+            }
+            handler = route ? route->handler : default_handler;
+        }
+        {
+            NETZER_TRACE_SPAN("http::Server::handle_request");
+            if(handler){ handler(request, response); }
+            else{ response.status = 404; }
+        }
+        send(session, std::move(response));
+    }
+
+    void send_error(const session_ptr &session, uint16_t status)
+    {
+        session->request.keep_alive = false;
+        session->request.version = "HTTP/1.1";
+        server_response_t response;
+        response.status = status;
+        send(session, std::move(response));
+    }
+
+    void send(const session_ptr &session, server_response_t response)
+    {
+        const auto &request = session->request;
+        std::vector<std::vector<uint8_t>> buffers;
+        buffers.push_back(serialize_head(request, response));
+        if(request.method != "HEAD" && !response.body.empty()){ buffers.push_back(std::move(response.body)); }
+
+        size_t num_bytes = 0;
+        for(const auto &b: buffers){ num_bytes += b.size(); }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stats.num_bytes_sent += num_bytes;
+        }
+        tcp_connection::write_cb_t write_cb;
+
+        if(!request.keep_alive)
+        {
+            session->closing = true;
+            std::weak_ptr<tcp_connection> weak_connection = session->connection;
+            write_cb = [weak_connection](bool, size_t)
+            {
+                auto connection = weak_connection.lock();
+                if(connection){ connection->close(); }
+            };
+        }
+        session->connection->write_buffers(std::move(buffers), std::move(write_cb));
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+Server::Server(io_service_t &io_service) :
+        m_impl(std::make_shared<ServerImpl>(io_service))
+{
+    std::weak_ptr<ServerImpl> weak_impl = m_impl;
+
+    m_impl->server.set_connection_callback([weak_impl](const tcp_connection_ptr &connection)
+                                           {
+                                               auto impl = weak_impl.lock();
+                                               if(impl){ impl->on_connect(connection); }
+                                           });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Server::Server() = default;
+
+///////////////////////////////////////////////////////////////////////////////
+
+Server::~Server() = default;
+
+///////////////////////////////////////////////////////////////////////////////
+
+Server::Server(Server &&other) noexcept
+{
+    std::swap(m_impl, other.m_impl);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Server &Server::operator=(Server other)
+{
+    std::swap(m_impl, other.m_impl);
+    return *this;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Server::start_listen(uint16_t port)
+{
+    return m_impl && m_impl->server.start_listen(port);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Server::stop_listen()
+{
+    if(m_impl){ m_impl->server.stop_listen(); }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+uint16_t Server::listening_port() const
+{
+    return m_impl ? m_impl->server.listening_port() : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Server::add_route(const std::string &method, const std::string &path, request_handler_t handler)
+{
+    ServerImpl::route_t route;
+    route.method = method;
+    route.path = path;
+    route.handler = std::move(handler);
+
+    if(route.path.ends_with('*'))
+    {
+        route.path.pop_back();
+        route.prefix = true;
+    }
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    m_impl->routes.push_back(std::move(route));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Server::set_default_handler(request_handler_t handler)
+{
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    m_impl->default_handler = std::move(handler);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t Server::max_body_size() const
+{
+    return m_impl->max_body_size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Server::set_max_body_size(size_t num_bytes)
+{
+    m_impl->max_body_size = num_bytes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+server_stats_t Server::stats() const
+{
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    return m_impl->stats;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+}// namespace
@@ -1,9 +1,13 @@
 
 #include <chrono>
+#include <coroutine>
+#include <deque>
+#include <mutex>
 #include <set>
 #include <utility>
 #include <boost/asio.hpp>
 #include "netzer/networking.hpp"
+#include "netzer/trace.hpp"
 
 #if defined(unix) || defined(__unix__) || defined(__unix)
 
@@ -263,10 +267,83 @@ public:
     udp::endpoint remote_endpoint;
     std::vector<uint8_t> recv_buffer;
     udp_server::receive_cb_t receive_function;
+
+    // set while a receive-operation is in flight
+    bool receiving = false;
+
+    // pending coroutine-receive
+    udp_server::receive_awaitable_t *receive_awaiter = nullptr;
+    std::coroutine_handle<> receive_continuation;
+
+    // guards receiving and the pending coroutine-receive, serializes issuing receive-operations
+    std::mutex mutex;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
+/*!
+ * issue the next receive-operation, unless one is in flight or there is no consumer
+ */
+static void receive_next(const std::shared_ptr<udp_server_impl> &impl)
+{
+    std::unique_lock<std::mutex> lock(impl->mutex);
+    if(impl->receiving || !impl->socket.is_open() || !(impl->receive_function || impl->receive_awaiter)){ return; }
+    impl->receiving = true;
+    std::weak_ptr<udp_server_impl> weak_impl = impl;
+
+    auto receive_fn = [weak_impl](const boost::system::error_code &error, std::size_t bytes_transferred)
+    {
+        auto impl = weak_impl.lock();
+        if(!impl){ return; }
+        NETZER_TRACE_SPAN("udp_server::receive");
+
+        // a pending coroutine takes precedence over the receive-function
+        udp_server::receive_awaitable_t *awaiter;
+        std::coroutine_handle<> continuation;
+        {
+            std::unique_lock<std::mutex> lock(impl->mutex);
+            impl->receiving = false;
+            awaiter = std::exchange(impl->receive_awaiter, nullptr);
+            continuation = std::exchange(impl->receive_continuation, {});
+        }
+
+        if(!error)
+        {
+            if(awaiter)
+            {
+                awaiter->result.data.assign(impl->recv_buffer.begin(), impl->recv_buffer.begin() + bytes_transferred);
+                awaiter->result.ip = impl->remote_endpoint.address().to_string();
+                awaiter->result.port = impl->remote_endpoint.port();
+            }
+            else if(impl->receive_function)
+            {
+                try
+                {
+                    std::vector<uint8_t> datavec(impl->recv_buffer.begin(),
+                                                 impl->recv_buffer.begin() +
+                                                 bytes_transferred);
+                    impl->receive_function(std::move(datavec),
+                                           impl->remote_endpoint.address().to_string(),
+                                           impl->remote_endpoint.port());
+                }
+                catch(std::exception &)
+                {
+//                    LOG_WARNING << e.what();
+                }
+            }
+        }
+        else
+        {
+//            LOG_WARNING << error.message();
+        }
+        if(continuation){ continuation.resume(); }
+        if(!error){ receive_next(impl); }
+    };
+    impl->socket.async_receive_from(boost::asio::buffer(impl->recv_buffer), impl->remote_endpoint, receive_fn);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
 udp_server::udp_server(boost::asio::io_service &io_service, receive_cb_t f) :
         m_impl(std::make_unique<udp_server_impl>(io_service, f))
 {
@@ -289,6 +366,7 @@ udp_server &udp_server::operator=(udp_server the_other)
 void udp_server::set_receive_function(receive_cb_t f)
 {
     m_impl->receive_function = std::move(f);
+    receive_next(m_impl);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -303,7 +381,6 @@ void udp_server::set_receive_buffer_size(size_t sz)
 void udp_server::start_listen(uint16_t port)
 {
     if(!m_impl){ return; }
-    std::weak_ptr<udp_server_impl> weak_impl = m_impl;
 
     try
     {
@@ -321,40 +398,7 @@ void udp_server::start_listen(uint16_t port)
         m_impl->socket.connect(udp::endpoint(udp::v4(), port));
     }
 
-    auto receive_fn = [this, weak_impl](const boost::system::error_code &error,
-                                        std::size_t bytes_transferred)
-    {
-        if(!error)
-        {
-            auto impl = weak_impl.lock();
-
-            if(impl && impl->receive_function)
-            {
-                try
-                {
-                    std::vector<uint8_t> datavec(impl->recv_buffer.begin(),
-                                                 impl->recv_buffer.begin() +
-                                                 bytes_transferred);
-                    impl->receive_function(std::move(datavec),
-                                           impl->remote_endpoint.address().to_string(),
-                                           impl->remote_endpoint.port());
-                }
-                catch(std::exception &)
-                {
-//                    LOG_WARNING << e.what();
-                }
-            }
-            if(impl && impl->socket.is_open())
-            {
-                start_listen(impl->socket.local_endpoint().port());
-            }
-        }
-        else
-        {
-//            LOG_WARNING << error.message();
-        }
-    };
-    m_impl->socket.async_receive_from(boost::asio::buffer(m_impl->recv_buffer), m_impl->remote_endpoint, receive_fn);
+    receive_next(m_impl);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -373,6 +417,32 @@ uint16_t udp_server::listening_port() const
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
+udp_server::receive_awaitable_t udp_server::receive()
+{
+    return {this, {}};
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool udp_server::receive_awaitable_t::await_suspend(std::coroutine_handle<> handle)
+{
+    // a copy, this awaiter might be gone once the receive completed
+    auto impl = server->m_impl;
+    if(!impl){ return false; }
+    {
+        std::unique_lock<std::mutex> lock(impl->mutex);
+
+        // not listening -> resume with an empty datagram
+        if(!impl->socket.is_open()){ return false; }
+        impl->receive_awaiter = this;
+        impl->receive_continuation = handle;
+    }
+    receive_next(impl);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
 struct tcp_server_impl
 {
     tcp::acceptor acceptor;
@@ -521,9 +591,31 @@ struct tcp_connection_impl
     boost::asio::basic_waitable_timer<steady_clock> m_deadline_timer;
     duration_t m_timeout;
 
+    // pending writes, transmitted in order with at most one write in flight
+    struct write_op_t
+    {
+        std::vector<std::vector<uint8_t>> buffers;
+        tcp_connection::write_cb_t cb;
+    };
+    std::deque<write_op_t> write_queue;
+
+    // also set while connecting, writes are held back until connected
+    bool write_in_flight = false;
+    std::mutex write_mutex;
+
     // additional receive callback with connection context
     tcp_connection::tcp_receive_cb_t tcp_receive_cb;
 
+    // pending coroutine-read, data arriving between reads and a flag for the end of the stream
+    tcp_connection::read_awaitable_t *read_awaiter = nullptr;
+    std::coroutine_handle<> read_continuation;
+    std::vector<uint8_t> read_backlog;
+    bool awaiting_reads = false, read_closed = false;
+
+    // set while receiving is paused by a full backlog
+    bool receive_paused = false;
+    std::mutex read_mutex;
+
     // used by Connection interface
     Connection::connection_cb_t m_connect_cb, m_disconnect_cb;
     Connection::receive_cb_t m_receive_cb;
@@ -531,6 +623,59 @@ struct tcp_connection_impl
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
+/*!
+ * pass received data to a pending coroutine-read or buffer it,
+ * returns the coroutine to resume, if any. an empty buffer marks the end of the stream.
+ */
+static std::coroutine_handle<> feed_reader(tcp_connection_impl &impl, const uint8_t *data, size_t num_bytes)
+{
+    std::unique_lock<std::mutex> lock(impl.read_mutex);
+    if(!num_bytes){ impl.read_closed = true; }
+
+    if(impl.read_awaiter)
+    {
+        auto *awaiter = std::exchange(impl.read_awaiter, nullptr);
+        awaiter->result = std::min(awaiter->num_bytes, num_bytes);
+        std::copy(data, data + awaiter->result, static_cast<uint8_t *>(awaiter->buffer));
+        data += awaiter->result;
+        num_bytes -= awaiter->result;
+    }
+    if(impl.awaiting_reads){ impl.read_backlog.insert(impl.read_backlog.end(), data, data + num_bytes); }
+    return std::exchange(impl.read_continuation, {});
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*!
+ * return true and mark receiving as paused, if the backlog for coroutine-reads is full
+ */
+static bool pause_receiving(tcp_connection_impl &impl)
+{
+    std::unique_lock<std::mutex> lock(impl.read_mutex);
+    impl.receive_paused = impl.read_backlog.size() >= tcp_connection::MAX_READ_BACKLOG;
+    return impl.receive_paused;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*!
+ * discard all queued writes, firing their completion-callbacks with failure
+ */
+static void fail_writes(tcp_connection_impl &impl)
+{
+    std::deque<tcp_connection_impl::write_op_t> ops;
+    {
+        std::unique_lock<std::mutex> lock(impl.write_mutex);
+        ops.swap(impl.write_queue);
+        impl.write_in_flight = false;
+    }
+    for(const auto &op: ops){ if(op.cb){ op.cb(false, 0); }}
+}
+
+static void write_queued(const std::shared_ptr<tcp_connection_impl> &impl);
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
 tcp_connection_ptr tcp_connection::create(boost::asio::io_service &io_service,
                                           const std::string &ip,
                                           uint16_t port,
@@ -540,6 +685,9 @@ tcp_connection_ptr tcp_connection::create(boost::asio::io_service &io_service,
 
     auto resolver_ptr = std::make_shared<tcp::resolver>(io_service);
 
+    // hold back writes until connected
+    ret->m_impl->write_in_flight = true;
+
     resolver_ptr->async_resolve({ip, std::to_string(port)}, [ret, resolver_ptr, ip]
             (const boost::system::error_code &ec,
              tcp::resolver::iterator end_point_it)
@@ -554,20 +702,37 @@ tcp_connection_ptr tcp_connection::create(boost::asio::io_service &io_service,
                                            {
                                                if(!ec)
                                                {
+                                                   {
+                                                       std::unique_lock<std::mutex> lock(ret->m_impl->write_mutex);
+                                                       ret->m_impl->write_in_flight = false;
+                                                       write_queued(ret->m_impl);
+                                                   }
                                                    if(ret->m_impl->m_connect_cb)
                                                    {
                                                        ret->m_impl->m_connect_cb(ret);
                                                    }
                                                    ret->start_receive();
                                                }
+                                               else
+                                               {
+                                                   fail_writes(*ret->m_impl);
+                                                   if(auto h = feed_reader(*ret->m_impl, nullptr, 0)){ h.resume(); }
+                                               }
                                            });
             }
             catch(std::exception &)
             {
 //                LOG_WARNING << ip << ": " << e.what();
+                fail_writes(*ret->m_impl);
+                if(auto h = feed_reader(*ret->m_impl, nullptr, 0)){ h.resume(); }
             }
         }
-//        else{ LOG_WARNING << ip << ": " << ec.message(); }
+        else
+        {
+//            LOG_WARNING << ip << ": " << ec.message();
+            fail_writes(*ret->m_impl);
+            if(auto h = feed_reader(*ret->m_impl, nullptr, 0)){ h.resume(); }
+        }
     });
     return ret;
 }
@@ -601,37 +766,139 @@ bool tcp_connection::open()
 
 size_t tcp_connection::write_bytes(const void *data, size_t num_bytes)
 {
-    auto bytes = std::vector<uint8_t>((uint8_t *) data, (uint8_t *) data + num_bytes);
-    auto buffer = boost::asio::buffer(bytes.data(), bytes.size());
-    auto impl_cp = m_impl;
+    std::vector<std::vector<uint8_t>> buffers(1);
+    buffers.front().assign((uint8_t *) data, (uint8_t *) data + num_bytes);
+    write_buffers(std::move(buffers));
+    return num_bytes;
+}
 
-    if(impl_cp->m_timeout != duration_t(0))
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*!
+ * start a gather-write for all queued buffers. requires a lock on write_mutex.
+ */
+static void write_queued(const std::shared_ptr<tcp_connection_impl> &impl)
+{
+    if(impl->write_in_flight || impl->write_queue.empty()){ return; }
+    impl->write_in_flight = true;
+
+    // all pending writes go out together
+    auto ops = std::make_shared<std::vector<tcp_connection_impl::write_op_t>>(
+            std::make_move_iterator(impl->write_queue.begin()), std::make_move_iterator(impl->write_queue.end()));
+    impl->write_queue.clear();
+
+    std::vector<boost::asio::const_buffer> buffers;
+    for(const auto &op: *ops)
     {
-        auto dur = duration_cast<steady_clock::duration>(impl_cp->m_timeout);
-        impl_cp->m_deadline_timer.expires_from_now(dur);
+        for(const auto &b: op.buffers){ buffers.emplace_back(b.data(), b.size()); }
     }
 
-    boost::asio::async_write(m_impl->socket, buffer, [impl_cp, bytes{std::move(bytes)}]
-            (const boost::system::error_code &error, std::size_t bytes_transferred)
+    if(impl->m_timeout != duration_t(0))
     {
-        if(!error)
+        auto dur = duration_cast<steady_clock::duration>(impl->m_timeout);
+        impl->m_deadline_timer.expires_from_now(dur);
+    }
+
+    boost::asio::async_write(impl->socket, buffers, [impl, ops]
+            (const boost::system::error_code &error, std::size_t /*bytes_transferred*/)
+    {
+        for(const auto &op: *ops)
         {
-            if(bytes_transferred < bytes.size())
+            if(op.cb)
             {
-//                LOG_WARNING << "not all bytes written";
+                size_t num_bytes = 0;
+                for(const auto &b: op.buffers){ num_bytes += b.size(); }
+                op.cb(!error, error ? 0 : num_bytes);
             }
         }
+        if(!error)
+        {
+            std::unique_lock<std::mutex> lock(impl->write_mutex);
+            impl->write_in_flight = false;
+            write_queued(impl);
+        }
         else
         {
-            switch(error.value())
+            fail_writes(*impl);
+//            LOG_TRACE_2 << error.message() << " (" << error.value() << ")";
+        }
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void tcp_connection::write_buffers(std::vector<std::vector<uint8_t>> buffers, write_cb_t cb)
+{
+    std::unique_lock<std::mutex> lock(m_impl->write_mutex);
+    m_impl->write_queue.push_back({std::move(buffers), std::move(cb)});
+    write_queued(m_impl);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+tcp_connection::read_awaitable_t tcp_connection::async_read(void *buffer, size_t num_bytes)
+{
+    return {this, buffer, num_bytes};
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool tcp_connection::read_awaitable_t::await_suspend(std::coroutine_handle<> handle)
+{
+    auto &impl = *connection->m_impl;
+    std::unique_lock<std::mutex> lock(impl.read_mutex);
+    impl.awaiting_reads = true;
+
+    // buffered data or end of stream -> resume immediately
+    if(!impl.read_backlog.empty())
+    {
+        result = std::min(num_bytes, impl.read_backlog.size());
+        std::copy(impl.read_backlog.begin(), impl.read_backlog.begin() + result, static_cast<uint8_t *>(buffer));
+        impl.read_backlog.erase(impl.read_backlog.begin(), impl.read_backlog.begin() + result);
+
+        // space in the backlog again -> resume receiving on the io-thread
+        if(impl.receive_paused && impl.read_backlog.size() < MAX_READ_BACKLOG)
+        {
+            impl.receive_paused = false;
+            boost::asio::post(impl.socket.get_executor(), [weak_connection = connection->weak_from_this()]
             {
-                case boost::asio::error::bad_descriptor:
-//                default:LOG_TRACE_2 << error.message() << " (" << error.value() << ")";
-                    break;
-            }
+                if(auto c = weak_connection.lock()){ c->start_receive(); }
+            });
         }
+        return false;
+    }
+    if(impl.read_closed || !num_bytes){ return false; }
+    impl.read_awaiter = this;
+    impl.read_continuation = handle;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+tcp_connection::write_awaitable_t tcp_connection::async_write(std::vector<uint8_t> bytes)
+{
+    std::vector<std::vector<uint8_t>> buffers(1);
+    buffers.front() = std::move(bytes);
+    return {this, std::move(buffers)};
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+tcp_connection::write_awaitable_t tcp_connection::async_write(std::vector<std::vector<uint8_t>> buffers)
+{
+    return {this, std::move(buffers)};
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void tcp_connection::write_awaitable_t::await_suspend(std::coroutine_handle<> handle)
+{
+    // captures fit into std::function's local storage, no allocation
+    connection->write_buffers(std::move(buffers), [this, handle](bool success, size_t num_bytes)
+    {
+        result = success ? num_bytes : 0;
+        handle.resume();
     });
-    return num_bytes;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -664,6 +931,7 @@ void tcp_connection::start_receive()
     impl_cp->socket.async_receive(boost::asio::buffer(impl_cp->recv_buffer), [impl_cp, weak_self]
             (const boost::system::error_code &error, std::size_t bytes_transferred)
     {
+        NETZER_TRACE_SPAN("tcp_connection::receive");
         auto self = weak_self.lock();
 
         if(!error)
@@ -686,9 +954,12 @@ void tcp_connection::start_receive()
                 }
 //                LOG_TRACE_2 << "tcp: received " << bytes_transferred << " bytes";
             }
+            auto continuation = bytes_transferred ?
+                    feed_reader(*impl_cp, impl_cp->recv_buffer.data(), bytes_transferred) : nullptr;
 
             // only keep receiving if there are any refs on this instance left
-            if(self){ self->start_receive(); }
+            if(self && !pause_receiving(*impl_cp)){ self->start_receive(); }
+            if(continuation){ continuation.resume(); }
         }
         else
         {
@@ -715,6 +986,9 @@ void tcp_connection::start_receive()
 //                default:LOG_TRACE_2 << error.message() << " (" << error.value() << ")";
                     break;
             }
+
+            // no more data for pending reads
+            if(auto continuation = feed_reader(*impl_cp, nullptr, 0)){ continuation.resume(); }
         }
     });
 }
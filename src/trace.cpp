@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "netzer/tsc_clock.hpp"
+#include "netzer/trace.hpp"
+
+namespace netzer::trace
+{
+
+namespace
+{
+// a complete span, fields are written by the owning thread and read concurrently by dump_json
+struct slot_t
+{
+    std::atomic<const char *> name{nullptr};
+    std::atomic<int64_t> start_ns{0}, end_ns{0};
+};
+
+// single-producer ring-buffer, owned by one thread
+struct thread_buffer_t
+{
+    thread_buffer_t(size_t num_events, uint32_t tid) : slots(num_events), tid(tid){}
+
+    std::vector<slot_t> slots;
+
+    // number of events written and index of the first event not discarded by clear()
+    std::atomic<uint64_t> head{0}, tail{0};
+
+    // guarded by registry_t::mutex
+    uint32_t tid;
+    std::string name;
+};
+
+struct registry_t
+{
+    std::mutex mutex;
+    std::vector<std::shared_ptr<thread_buffer_t>> buffers;
+
+    // buffers of exited threads, still registered and reused by new threads
+    std::vector<std::shared_ptr<thread_buffer_t>> free_buffers;
+    uint32_t next_tid = 1;
+
+    std::atomic<size_t> buffer_size{32768};
+};
+
+// intentionally leaked, threads might record events during static destruction
+registry_t &registry()
+{
+    static auto *ret = new registry_t;
+    return *ret;
+}
+
+// hands its buffer back on thread-exit. it stays registered, so late dumps include its events
+struct buffer_holder_t
+{
+    std::shared_ptr<thread_buffer_t> buffer;
+
+    ~buffer_holder_t()
+    {
+        if(!buffer){ return; }
+        auto &r = registry();
+        std::unique_lock<std::mutex> lock(r.mutex);
+        r.free_buffers.push_back(std::move(buffer));
+    }
+};
+thread_local buffer_holder_t t_buffer;
+
+thread_buffer_t &local_buffer()
+{
+    if(!t_buffer.buffer)
+    {
+        auto &r = registry();
+        std::unique_lock<std::mutex> lock(r.mutex);
+        size_t capacity = std::max<size_t>(r.buffer_size, 1);
+
+        // recycle a buffer of an exited thread, so short-lived threads do not accumulate buffers
+        while(!r.free_buffers.empty() && !t_buffer.buffer)
+        {
+            auto buffer = std::move(r.free_buffers.back());
+            r.free_buffers.pop_back();
+
+            if(buffer->slots.size() == capacity)
+            {
+                buffer->tid = r.next_tid++;
+                buffer->name.clear();
+                buffer->tail = buffer->head.load(std::memory_order_relaxed);
+                t_buffer.buffer = std::move(buffer);
+            }
+            else{ std::erase(r.buffers, buffer); }
+        }
+
+        if(!t_buffer.buffer)
+        {
+            t_buffer.buffer = std::make_shared<thread_buffer_t>(capacity, r.next_tid++);
+            r.buffers.push_back(t_buffer.buffer);
+        }
+    }
+    return *t_buffer.buffer;
+}
+
+inline int64_t now_ns()
+{
+    return crocore::tsc_clock::now().time_since_epoch().count();
+}
+
+void append_escaped(std::string &out, const char *str)
+{
+    for(; *str; ++str)
+    {
+        auto c = static_cast<unsigned char>(*str);
+
+        if(c == '"' || c == '\\'){ out += '\\'; out += static_cast<char>(c); }
+        else if(c < 0x20)
+        {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        }
+        else{ out += static_cast<char>(c); }
+    }
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+// constant-initialized, usable during static initialization and destruction
+std::atomic<bool> detail::g_enabled{false};
+
+///////////////////////////////////////////////////////////////////////////////
+
+void set_enabled(bool b)
+{
+    // calibrate up front, not within a first span
+    if(b){ crocore::tsc_clock::available(); }
+    detail::g_enabled.store(b, std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void set_buffer_size(size_t num_events)
+{
+    registry().buffer_size = num_events;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void set_thread_name(const std::string &name)
+{
+    auto &buffer = local_buffer();
+    std::unique_lock<std::mutex> lock(registry().mutex);
+    buffer.name = name;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void record(const char *name, int64_t start_ns, int64_t end_ns)
+{
+    if(!enabled()){ return; }
+    auto &buffer = local_buffer();
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    auto &slot = buffer.slots[head % buffer.slots.size()];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start_ns.store(start_ns, std::memory_order_relaxed);
+    slot.end_ns.store(end_ns, std::memory_order_relaxed);
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::string dump_json()
+{
+    std::vector<std::shared_ptr<thread_buffer_t>> buffers;
+    std::vector<std::string> names;
+    std::vector<uint32_t> tids;
+    {
+        std::unique_lock<std::mutex> lock(registry().mutex);
+        buffers = registry().buffers;
+        for(const auto &b: buffers){ names.push_back(b->name); tids.push_back(b->tid); }
+    }
+
+    struct event_t
+    {
+        const char *name;
+        int64_t start_ns, end_ns;
+    };
+    std::vector<event_t> events;
+    std::string ret = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first_event = true;
+    char buf[160];
+
+    for(size_t i = 0; i < buffers.size(); ++i)
+    {
+        auto &buffer = *buffers[i];
+        size_t capacity = buffer.slots.size();
+
+        if(!names[i].empty())
+        {
+            snprintf(buf, sizeof(buf), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+                     first_event ? "" : ",", tids[i]);
+            ret += buf;
+            append_escaped(ret, names[i].c_str());
+            ret += "\"}}";
+            first_event = false;
+        }
+
+        // copy all events, then drop those the writer might have overwritten meanwhile
+        uint64_t head = buffer.head.load(std::memory_order_acquire);
+        uint64_t begin = std::max(head > capacity ? head - capacity : 0, buffer.tail.load());
+        events.clear();
+
+        for(uint64_t j = begin; j < head; ++j)
+        {
+            const auto &slot = buffer.slots[j % capacity];
+            events.push_back({slot.name.load(std::memory_order_relaxed),
+                              slot.start_ns.load(std::memory_order_relaxed),
+                              slot.end_ns.load(std::memory_order_relaxed)});
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t new_head = buffer.head.load(std::memory_order_relaxed);
+        uint64_t valid_begin = new_head >= capacity ? new_head - capacity + 1 : 0;
+        size_t num_invalid = valid_begin > begin ? std::min<uint64_t>(valid_begin - begin, events.size()) : 0;
+
+        for(size_t j = num_invalid; j < events.size(); ++j)
+        {
+            const auto &e = events[j];
+            if(!e.name){ continue; }
+
+            ret += first_event ? "{\"name\":\"" : ",{\"name\":\"";
+            append_escaped(ret, e.name);
+            snprintf(buf, sizeof(buf), "\",\"cat\":\"netzer\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                     static_cast<double>(e.start_ns) / 1.0e3,
+                     static_cast<double>(e.end_ns - e.start_ns) / 1.0e3, tids[i]);
+            ret += buf;
+            first_event = false;
+        }
+    }
+    ret += "]}";
+    return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool dump_json(const std::string &path)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if(!out){ return false; }
+    auto json = dump_json();
+    out.write(json.data(), static_cast<std::streamsize>(json.size()));
+    return static_cast<bool>(out);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void clear()
+{
+    std::unique_lock<std::mutex> lock(registry().mutex);
+    for(auto &b: registry().buffers){ b->tail = b->head.load(std::memory_order_acquire); }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int64_t detail::span_begin()
+{
+    return now_ns();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void detail::span_end(const char *name, int64_t start_ns)
+{
+    record(name, start_ns, now_ns());
+}
+
+}// namespace
@@ -0,0 +1,87 @@
+#include <thread>
+#include "netzer/tsc_clock.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace crocore
+{
+
+namespace
+{
+// interval used for calibration
+constexpr auto g_calibration_interval = std::chrono::milliseconds(10);
+
+/*!
+ * return true, if the timestamp-counter runs at a constant rate across all cores and power-states
+ */
+bool invariant_counter()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+    // cpuid 0x80000007, edx bit 8: invariant TSC
+    if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)){ return false; }
+    return edx & (1u << 8);
+#elif defined(__aarch64__)
+    // the generic timer is architecturally invariant
+    return true;
+#else
+    return false;
+#endif
+}
+
+/*!
+ * read counter and steady_clock as close together as possible,
+ * using the sample with the shortest bracket from a few attempts
+ */
+void sample(uint64_t &ticks, int64_t &ns)
+{
+    uint64_t best = UINT64_MAX;
+
+    for(int i = 0; i < 8; ++i)
+    {
+        uint64_t t0 = tsc_clock::ticks();
+        auto now = std::chrono::steady_clock::now();
+        uint64_t t1 = tsc_clock::ticks();
+
+        if(t1 - t0 < best)
+        {
+            best = t1 - t0;
+            ticks = t0 + (t1 - t0) / 2;
+            ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+        }
+    }
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+tsc_clock::calibration_t tsc_clock::calibrate()
+{
+    calibration_t ret = {};
+    if(!invariant_counter()){ return ret; }
+
+    uint64_t ticks_start = 0, ticks_end = 0;
+    int64_t ns_start = 0, ns_end = 0;
+    sample(ticks_start, ns_start);
+    std::this_thread::sleep_for(g_calibration_interval);
+    sample(ticks_end, ns_end);
+
+    if(ticks_end <= ticks_start || ns_end <= ns_start){ return ret; }
+
+    ret.ticks_per_second = static_cast<double>(ticks_end - ticks_start) * 1.0e9 /
+                           static_cast<double>(ns_end - ns_start);
+
+    // implausible frequencies (< 1MHz) indicate an unusable counter
+    if(ret.ticks_per_second < 1.0e6){ return {}; }
+
+    ret.ns_per_tick = 1.0e9 / ret.ticks_per_second;
+    ret.base_ticks = ticks_end;
+    ret.base_ns = ns_end;
+    ret.invariant = true;
+    return ret;
+}
+
+}// namespace
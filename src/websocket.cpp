@@ -0,0 +1,1043 @@
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <random>
+#include "netzer/Timer.hpp"
+#include "netzer/websocket.hpp"
+
+namespace netzer::websocket
+{
+
+namespace
+{
+
+// appended to the client's key, to derive Sec-WebSocket-Accept (RFC 6455, 1.3)
+constexpr char g_accept_guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// limit for handshake-requests/responses
+constexpr size_t g_max_handshake_size = 16 * (1 << 10);
+
+std::array<uint8_t, 20> sha1(std::string_view input)
+{
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    std::vector<uint8_t> msg(input.begin(), input.end());
+    uint64_t num_bits = static_cast<uint64_t>(input.size()) * 8;
+    msg.push_back(0x80);
+    while(msg.size() % 64 != 56){ msg.push_back(0); }
+    for(int i = 7; i >= 0; --i){ msg.push_back(static_cast<uint8_t>(num_bits >> (i * 8))); }
+
+    auto rotl = [](uint32_t v, int n){ return (v << n) | (v >> (32 - n)); };
+
+    for(size_t block = 0; block < msg.size(); block += 64)
+    {
+        uint32_t w[80];
+
+        for(int i = 0; i < 16; ++i)
+        {
+            const uint8_t *p = &msg[block + 4 * i];
+            w[i] = uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | uint32_t(p[3]);
+        }
+        for(int i = 16; i < 80; ++i){ w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1); }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+
+        for(int i = 0; i < 80; ++i)
+        {
+            uint32_t f, k;
+            if(i < 20){ f = (b & c) | (~b & d), k = 0x5A827999; }
+            else if(i < 40){ f = b ^ c ^ d, k = 0x6ED9EBA1; }
+            else if(i < 60){ f = (b & c) | (b & d) | (c & d), k = 0x8F1BBCDC; }
+            else{ f = b ^ c ^ d, k = 0xCA62C1D6; }
+            uint32_t tmp = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = tmp;
+        }
+        h[0] += a, h[1] += b, h[2] += c, h[3] += d, h[4] += e;
+    }
+    std::array<uint8_t, 20> ret = {};
+    for(size_t i = 0; i < ret.size(); ++i){ ret[i] = static_cast<uint8_t>(h[i / 4] >> (24 - 8 * (i % 4))); }
+    return ret;
+}
+
+std::string base64_encode(const uint8_t *data, size_t num_bytes)
+{
+    constexpr char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string ret;
+    ret.reserve((num_bytes + 2) / 3 * 4);
+
+    for(size_t i = 0; i < num_bytes; i += 3)
+    {
+        uint32_t v = uint32_t(data[i]) << 16;
+        if(i + 1 < num_bytes){ v |= uint32_t(data[i + 1]) << 8; }
+        if(i + 2 < num_bytes){ v |= data[i + 2]; }
+        ret.push_back(table[(v >> 18) & 0x3F]);
+        ret.push_back(table[(v >> 12) & 0x3F]);
+        ret.push_back(i + 1 < num_bytes ? table[(v >> 6) & 0x3F] : '=');
+        ret.push_back(i + 2 < num_bytes ? table[v & 0x3F] : '=');
+    }
+    return ret;
+}
+
+std::string accept_key(const std::string &key)
+{
+    auto digest = sha1(key + g_accept_guid);
+    return base64_encode(digest.data(), digest.size());
+}
+
+/*!
+ * apply (or remove) a masking-key in place.
+ * operates on 8-byte words, which compilers also unroll into SIMD-registers.
+ */
+void apply_mask(uint8_t *data, size_t num_bytes, const uint8_t key[4])
+{
+    uint8_t pattern[8];
+    for(size_t i = 0; i < 8; ++i){ pattern[i] = key[i % 4]; }
+    uint64_t mask;
+    memcpy(&mask, pattern, sizeof(mask));
+    size_t i = 0;
+
+    for(; i + 8 <= num_bytes; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        word ^= mask;
+        memcpy(data + i, &word, sizeof(word));
+    }
+    for(; i < num_bytes; ++i){ data[i] ^= key[i % 4]; }
+}
+
+bool iequals(std::string_view lhs, std::string_view rhs)
+{
+    return lhs.size() == rhs.size() &&
+           std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](char a, char b)
+           {
+               return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+           });
+}
+
+bool icontains(std::string_view str, std::string_view token)
+{
+    for(size_t i = 0; i + token.size() <= str.size(); ++i)
+    {
+        if(iequals(str.substr(i, token.size()), token)){ return true; }
+    }
+    return false;
+}
+
+/*!
+ * return the value for a header within a handshake (case-insensitive), or an empty view
+ */
+std::string_view find_header(std::string_view head, std::string_view name)
+{
+    size_t pos = head.find("\r\n");
+
+    while(pos != std::string_view::npos && pos + 2 < head.size())
+    {
+        auto line_start = pos + 2;
+        pos = head.find("\r\n", line_start);
+        auto line = head.substr(line_start, pos == std::string_view::npos ? pos : pos - line_start);
+        auto colon_pos = line.find(':');
+
+        if(colon_pos != std::string_view::npos && iequals(line.substr(0, colon_pos), name))
+        {
+            auto value = line.substr(colon_pos + 1);
+            auto begin = value.find_first_not_of(" \t");
+            auto end = value.find_last_not_of(" \t");
+            return begin == std::string_view::npos ? std::string_view() : value.substr(begin, end - begin + 1);
+        }
+    }
+    return {};
+}
+
+std::vector<uint8_t> to_bytes(std::string_view str){ return {str.begin(), str.end()}; }
+
+/*!
+ * return true for well-formed UTF-8 (no overlong forms, surrogates or code-points above U+10FFFF).
+ * runs of ASCII are skipped in 8-byte words.
+ */
+bool valid_utf8(const uint8_t *data, size_t num_bytes)
+{
+    size_t i = 0;
+
+    while(i < num_bytes)
+    {
+        if(i + 8 <= num_bytes)
+        {
+            uint64_t word;
+            memcpy(&word, data + i, sizeof(word));
+            if(!(word & 0x8080808080808080ULL)){ i += 8; continue; }
+        }
+        uint8_t c = data[i];
+        if(c < 0x80){ ++i; continue; }
+
+        size_t num_continuation;
+        uint8_t lo = 0x80, hi = 0xBF;
+
+        if(c >= 0xC2 && c <= 0xDF){ num_continuation = 1; }
+        else if(c >= 0xE0 && c <= 0xEF)
+        {
+            num_continuation = 2;
+            if(c == 0xE0){ lo = 0xA0; }
+            else if(c == 0xED){ hi = 0x9F; }
+        }
+        else if(c >= 0xF0 && c <= 0xF4)
+        {
+            num_continuation = 3;
+            if(c == 0xF0){ lo = 0x90; }
+            else if(c == 0xF4){ hi = 0x8F; }
+        }
+        else{ return false; }
+
+        if(i + num_continuation >= num_bytes){ return false; }
+        if(data[i + 1] < lo || data[i + 1] > hi){ return false; }
+
+        for(size_t j = 2; j <= num_continuation; ++j)
+        {
+            if((data[i + j] & 0xC0) != 0x80){ return false; }
+        }
+        i += num_continuation + 1;
+    }
+    return true;
+}
+
+/*!
+ * return true for status-codes a peer may send in a close-frame (RFC 6455, 7.4)
+ */
+bool valid_close_code(uint16_t code)
+{
+    return (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1014) || (code >= 3000 && code <= 4999);
+}
+
+}// namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct WebSocketImpl
+{
+    enum class state_t{ CONNECTING, OPEN, CLOSING, CLOSED };
+
+    std::weak_ptr<WebSocket> self;
+    tcp_connection_ptr connection;
+
+    // the client-side masks outgoing frames, the server-side requires masked frames
+    bool client = false;
+
+    std::atomic<state_t> state = state_t::CONNECTING;
+    std::string path, host, key;
+
+    // received, unparsed bytes
+    std::vector<uint8_t> buffer;
+
+    // reassembly of fragmented messages
+    std::vector<uint8_t> fragments;
+    opcode_t fragment_opcode = opcode_t::BINARY;
+    bool in_fragment = false;
+
+    std::atomic<size_t> max_message_size{WebSocket::DEFAULT_MAX_MESSAGE_SIZE};
+    size_t max_frame_size = 0;
+
+    // set by the side sending the first close-frame, from any thread
+    std::atomic<bool> close_sent{false};
+    bool close_notified = false;
+
+    // drops the connection, if the peer does not answer our close-frame in time
+    crocore::Timer close_timer;
+    std::atomic<double> close_timeout{WebSocket::DEFAULT_CLOSE_TIMEOUT};
+
+    // guarded by mutex, copied before invocation
+    WebSocket::open_cb_t open_cb;
+    WebSocket::message_cb_t message_cb;
+    WebSocket::pong_cb_t pong_cb;
+    WebSocket::close_cb_t close_cb;
+
+    // used by a Server to track its connections
+    std::function<void()> disconnect_hook;
+
+    // protects rng, stats, callbacks and ordering of fragmented writes
+    mutable std::mutex mutex;
+    std::mt19937 rng{std::random_device()()};
+    stats_t stats;
+
+    void on_receive(std::vector<uint8_t> data);
+
+    // process a handshake, returns false if incomplete
+    bool handshake();
+
+    // parse and handle frames in place, returns the number of consumed bytes
+    size_t parse(uint8_t *data, size_t num_bytes);
+
+    void handle_frame(opcode_t opcode, bool fin, const uint8_t *payload, size_t num_bytes);
+
+    void send(opcode_t opcode, std::vector<uint8_t> payload);
+
+    // append a frame-header to <out> and mask the payload in place, if required. requires a lock.
+    void add_frame(std::vector<std::vector<uint8_t>> &out, opcode_t opcode, bool fin, std::vector<uint8_t> payload);
+
+    // fail the connection with a status-code
+    void fail(uint16_t code);
+
+    void notify_close(uint16_t code, std::string_view reason);
+
+    void on_disconnect();
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WebSocketImpl::on_receive(std::vector<uint8_t> data)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stats.num_bytes_received += data.size();
+    }
+    if(state == state_t::CLOSED){ return; }
+
+    if(state == state_t::CONNECTING)
+    {
+        buffer.insert(buffer.end(), data.begin(), data.end());
+        if(!handshake()){ return; }
+        data.swap(buffer);
+        buffer.clear();
+    }
+
+    // parse directly from the received buffer, without copying
+    if(buffer.empty())
+    {
+        size_t num_consumed = parse(data.data(), data.size());
+        if(num_consumed < data.size()){ buffer.assign(data.begin() + num_consumed, data.end()); }
+    }
+    else
+    {
+        buffer.insert(buffer.end(), data.begin(), data.end());
+        size_t num_consumed = parse(buffer.data(), buffer.size());
+        buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(num_consumed));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool WebSocketImpl::handshake()
+{
+    std::string_view view(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+    auto head_end = view.find("\r\n\r\n");
+
+    if(head_end == std::string_view::npos)
+    {
+        if(buffer.size() > g_max_handshake_size){ fail(CLOSE_PROTOCOL_ERROR); }
+        return false;
+    }
+    auto head = view.substr(0, head_end + 2);
+    auto status_line = head.substr(0, head.find("\r\n"));
+
+    if(client)
+    {
+        // server needs to switch protocols and prove it understood our key
+        if(!status_line.starts_with("HTTP/1.1 101") || find_header(head, "sec-websocket-accept") != accept_key(key))
+        {
+            fail(CLOSE_PROTOCOL_ERROR);
+            return false;
+        }
+    }
+    else
+    {
+        auto client_key = find_header(head, "sec-websocket-key");
+        bool valid = status_line.starts_with("GET ") && icontains(find_header(head, "upgrade"), "websocket") &&
+                     icontains(find_header(head, "connection"), "upgrade") && !client_key.empty() &&
+                     find_header(head, "sec-websocket-version") == "13";
+
+        if(!valid)
+        {
+            state = state_t::CLOSED;
+            auto weak_connection = std::weak_ptr<tcp_connection>(connection);
+            connection->write_buffers({to_bytes("HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n"
+                                                "Sec-WebSocket-Version: 13\r\nConnection: close\r\n\r\n")},
+                                      [weak_connection](bool, size_t)
+                                      {
+                                          if(auto c = weak_connection.lock()){ c->close(); }
+                                      });
+            return false;
+        }
+        auto target = status_line.substr(4, status_line.find(' ', 4) - 4);
+        path = std::string(target);
+        std::string response = "HTTP/1.1 101 Switching Protocols\r\n"
+                               "Upgrade: websocket\r\n"
+                               "Connection: Upgrade\r\n"
+                               "Sec-WebSocket-Accept: " + accept_key(std::string(client_key)) + "\r\n\r\n";
+        connection->write_buffers({to_bytes(response)});
+    }
+
+    // keep bytes following the handshake, they already belong to frames
+    buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(head_end + 4));
+    state = state_t::OPEN;
+
+    if(auto ws = self.lock())
+    {
+        WebSocket::open_cb_t cb;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cb = open_cb;
+        }
+        if(cb){ cb(ws); }
+    }
+    return state != state_t::CLOSED;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t WebSocketImpl::parse(uint8_t *data, size_t num_bytes)
+{
+    size_t pos = 0;
+
+    while(state != state_t::CLOSED)
+    {
+        const uint8_t *p = data + pos;
+        size_t available = num_bytes - pos;
+        if(available < 2){ break; }
+
+        bool fin = p[0] & 0x80;
+        bool masked = p[1] & 0x80;
+        auto opcode = static_cast<opcode_t>(p[0] & 0x0F);
+        uint64_t payload_size = p[1] & 0x7F;
+        size_t header_size = 2;
+
+        if(payload_size == 126)
+        {
+            header_size += 2;
+            if(available < header_size){ break; }
+            payload_size = uint64_t(p[2]) << 8 | p[3];
+        }
+        else if(payload_size == 127)
+        {
+            header_size += 8;
+            if(available < header_size){ break; }
+            payload_size = 0;
+            for(int i = 0; i < 8; ++i){ payload_size = payload_size << 8 | p[2 + i]; }
+        }
+        if(masked){ header_size += 4; }
+
+        // reserved bits without negotiated extensions, or masking-rule violated
+        if((p[0] & 0x70) || masked == client)
+        {
+            fail(CLOSE_PROTOCOL_ERROR);
+            break;
+        }
+
+        // reject oversized messages early, before buffering their payload
+        if(payload_size > max_message_size)
+        {
+            fail(CLOSE_MESSAGE_TOO_BIG);
+            break;
+        }
+        if(available < header_size + payload_size){ break; }
+
+        auto *payload = data + pos + header_size;
+        if(masked){ apply_mask(payload, payload_size, payload - 4); }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stats.num_frames_received++;
+        }
+        handle_frame(opcode, fin, payload, payload_size);
+        pos += header_size + payload_size;
+    }
+    return pos;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WebSocketImpl::handle_frame(opcode_t opcode, bool fin, const uint8_t *payload, size_t num_bytes)
+{
+    auto ws = self.lock();
+    if(!ws){ return; }
+
+    auto deliver = [this, &ws](opcode_t op, const uint8_t *data, size_t size)
+    {
+        if(op == opcode_t::TEXT && !valid_utf8(data, size))
+        {
+            fail(CLOSE_INVALID_PAYLOAD);
+            return;
+        }
+        WebSocket::message_cb_t cb;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stats.num_messages_received++;
+            cb = message_cb;
+        }
+        if(cb){ cb(ws, {op, data, size}); }
+    };
+
+    switch(opcode)
+    {
+        case opcode_t::TEXT:
+        case opcode_t::BINARY:
+            if(in_fragment){ fail(CLOSE_PROTOCOL_ERROR); }
+
+            // unfragmented message -> deliver in place
+            else if(fin){ deliver(opcode, payload, num_bytes); }
+            else
+            {
+                fragments.assign(payload, payload + num_bytes);
+                fragment_opcode = opcode;
+                in_fragment = true;
+            }
+            break;
+
+        case opcode_t::CONTINUATION:
+            if(!in_fragment){ fail(CLOSE_PROTOCOL_ERROR); }
+            else if(fragments.size() + num_bytes > max_message_size){ fail(CLOSE_MESSAGE_TOO_BIG); }
+            else
+            {
+                fragments.insert(fragments.end(), payload, payload + num_bytes);
+
+                if(fin)
+                {
+                    in_fragment = false;
+                    deliver(fragment_opcode, fragments.data(), fragments.size());
+                    fragments.clear();
+                }
+            }
+            break;
+
+        case opcode_t::PING:
+        case opcode_t::PONG:
+        case opcode_t::CLOSE:
+            // control-frames must not be fragmented and carry at most 125 bytes
+            if(!fin || num_bytes > 125)
+            {
+                fail(CLOSE_PROTOCOL_ERROR);
+                break;
+            }
+            if(opcode == opcode_t::PING){ send(opcode_t::PONG, {payload, payload + num_bytes}); }
+            else if(opcode == opcode_t::PONG)
+            {
+                WebSocket::pong_cb_t cb;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cb = pong_cb;
+                }
+                if(cb){ cb(ws, {reinterpret_cast<const char *>(payload), num_bytes}); }
+            }
+            else
+            {
+                if(num_bytes == 1){ fail(CLOSE_PROTOCOL_ERROR); break; }
+                uint16_t code = num_bytes >= 2 ? uint16_t(payload[0] << 8 | payload[1]) : uint16_t(CLOSE_NO_STATUS);
+                std::string_view reason;
+                if(num_bytes > 2){ reason = {reinterpret_cast<const char *>(payload + 2), num_bytes - 2}; }
+
+                // reserved status-codes (e.g. 1005, 1006) must not appear on the wire
+                if((num_bytes >= 2 && !valid_close_code(code)) ||
+                   !valid_utf8(reinterpret_cast<const uint8_t *>(reason.data()), reason.size()))
+                {
+                    fail(CLOSE_PROTOCOL_ERROR);
+                    break;
+                }
+
+                // echo the close-frame, unless we initiated the closing-handshake
+                if(!close_sent.exchange(true))
+                {
+                    state = state_t::CLOSING;
+                    send(opcode_t::CLOSE, {payload, payload + std::min<size_t>(num_bytes, 2)});
+                }
+                state = state_t::CLOSED;
+                auto weak_connection = std::weak_ptr<tcp_connection>(connection);
+                connection->write_buffers({}, [weak_connection](bool, size_t)
+                {
+                    if(auto c = weak_connection.lock()){ c->close(); }
+                });
+                notify_close(code, reason);
+            }
+            break;
+
+        default:
+            fail(CLOSE_PROTOCOL_ERROR);
+            break;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WebSocketImpl::add_frame(std::vector<std::vector<uint8_t>> &out, opcode_t opcode, bool fin,
+                              std::vector<uint8_t> payload)
+{
+    std::vector<uint8_t> header;
+    header.reserve(14);
+    header.push_back(static_cast<uint8_t>((fin ? 0x80 : 0x00) | static_cast<uint8_t>(opcode)));
+    uint8_t mask_bit = client ? 0x80 : 0x00;
+    uint64_t num_bytes = payload.size();
+
+    if(num_bytes < 126){ header.push_back(mask_bit | static_cast<uint8_t>(num_bytes)); }
+    else if(num_bytes <= 0xFFFF)
+    {
+        header.push_back(mask_bit | 126);
+        header.push_back(static_cast<uint8_t>(num_bytes >> 8));
+        header.push_back(static_cast<uint8_t>(num_bytes));
+    }
+    else
+    {
+        header.push_back(mask_bit | 127);
+        for(int i = 7; i >= 0; --i){ header.push_back(static_cast<uint8_t>(num_bytes >> (8 * i))); }
+    }
+
+    if(client)
+    {
+        uint32_t mask_key = rng();
+        uint8_t key[4];
+        memcpy(key, &mask_key, sizeof(key));
+        header.insert(header.end(), key, key + 4);
+        apply_mask(payload.data(), payload.size(), key);
+    }
+    stats.num_frames_sent++;
+    stats.num_bytes_sent += header.size() + payload.size();
+    out.push_back(std::move(header));
+    if(!payload.empty()){ out.push_back(std::move(payload)); }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WebSocketImpl::send(opcode_t opcode, std::vector<uint8_t> payload)
+{
+    std::vector<std::vector<uint8_t>> buffers;
+    std::unique_lock<std::mutex> lock(mutex);
+    bool is_control = static_cast<uint8_t>(opcode) & 0x08;
+
+    if(is_control || !max_frame_size || payload.size() <= max_frame_size)
+    {
+        add_frame(buffers, opcode, true, std::move(payload));
+    }
+    else
+    {
+        // fragmented message
+        for(size_t offset = 0; offset < payload.size(); offset += max_frame_size)
+        {
+            size_t num_bytes = std::min(max_frame_size, payload.size() - offset);
+            bool fin = offset + num_bytes == payload.size();
+            add_frame(buffers, offset ? opcode_t::CONTINUATION : opcode, fin,
+                      {payload.begin() + static_cast<std::ptrdiff_t>(offset),
+                       payload.begin() + static_cast<std::ptrdiff_t>(offset + num_bytes)});
+        }
+    }
+    if(!is_control){ stats.num_messages_sent++; }
+
+    // a single call keeps all fragments together, with respect to other threads
+    connection->write_buffers(std::move(buffers));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WebSocketImpl::fail(uint16_t code)
+{
+    if(state == state_t::CLOSED){ return; }
+
+    if(state != state_t::CONNECTING && !close_sent.exchange(true))
+    {
+        send(opcode_t::CLOSE, {static_cast<uint8_t>(code >> 8), static_cast<uint8_t>(code)});
+    }
+    state = state_t::CLOSED;
+    auto weak_connection = std::weak_ptr<tcp_connection>(connection);
+    connection->write_buffers({}, [weak_connection](bool, size_t)
+    {
+        if(auto c = weak_connection.lock()){ c->close(); }
+    });
+    notify_close(code, {});
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WebSocketImpl::notify_close(uint16_t code, std::string_view reason)
+{
+    if(close_notified){ return; }
+    close_notified = true;
+
+    if(auto ws = self.lock())
+    {
+        WebSocket::close_cb_t cb;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cb = close_cb;
+        }
+        if(cb){ cb(ws, code, reason); }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WebSocketImpl::on_disconnect()
+{
+    state = state_t::CLOSED;
+    notify_close(CLOSE_ABNORMAL, {});
+    if(disconnect_hook){ disconnect_hook(); }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*!
+ * wire up receive- and disconnect-callbacks of the underlying tcp_connection
+ */
+static void attach(io_service_t &io_service, const WebSocketPtr &ws, const std::shared_ptr<WebSocketImpl> &impl)
+{
+    std::weak_ptr<WebSocketImpl> weak_impl = impl;
+    std::weak_ptr<tcp_connection> weak_connection = impl->connection;
+    impl->self = ws;
+    impl->close_timer = crocore::Timer(io_service, [weak_connection]
+    {
+        if(auto c = weak_connection.lock()){ c->close(); }
+    });
+
+    impl->connection->set_tcp_receive_cb([weak_impl](const tcp_connection_ptr &, std::vector<uint8_t> data)
+                                         {
+                                             if(auto impl = weak_impl.lock()){ impl->on_receive(std::move(data)); }
+                                         });
+    impl->connection->set_disconnect_cb([weak_impl](const ConnectionPtr &)
+                                        {
+                                            if(auto impl = weak_impl.lock()){ impl->on_disconnect(); }
+                                        });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+WebSocketPtr WebSocket::connect(io_service_t &io_service, const std::string &url, open_cb_t open_cb)
+{
+    constexpr std::string_view scheme = "ws://";
+    if(url.size() <= scheme.size() || !iequals(std::string_view(url).substr(0, scheme.size()), scheme)){ return {}; }
+
+    auto authority_end = url.find('/', scheme.size());
+    auto authority = url.substr(scheme.size(), authority_end - scheme.size());
+    auto port_pos = authority.rfind(':');
+    uint16_t port = 80;
+    std::string host = authority;
+
+    if(port_pos != std::string::npos && authority.find(']', port_pos) == std::string::npos)
+    {
+        try{ port = static_cast<uint16_t>(std::stoul(authority.substr(port_pos + 1))); }
+        catch(std::exception &){ return {}; }
+        host = authority.substr(0, port_pos);
+    }
+    if(host.empty()){ return {}; }
+
+    auto ws = WebSocketPtr(new WebSocket());
+    auto impl = std::make_shared<WebSocketImpl>();
+    ws->m_impl = impl;
+    impl->client = true;
+    impl->host = authority;
+    impl->path = authority_end == std::string::npos ? "/" : url.substr(authority_end);
+    impl->open_cb = std::move(open_cb);
+
+    uint8_t nonce[16];
+    for(auto &b: nonce){ b = static_cast<uint8_t>(impl->rng()); }
+    impl->key = base64_encode(nonce, sizeof(nonce));
+
+    impl->connection = tcp_connection::create(io_service, host, port);
+    attach(io_service, ws, impl);
+
+    // writes are held back until connected, so the request can be queued right away
+    std::string request = "GET " + impl->path + " HTTP/1.1\r\n"
+                          "Host: " + impl->host + "\r\n"
+                          "Upgrade: websocket\r\n"
+                          "Connection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: " + impl->key + "\r\n"
+                          "Sec-WebSocket-Version: 13\r\n\r\n";
+    impl->connection->write_buffers({to_bytes(request)});
+    return ws;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+WebSocket::~WebSocket()
+{
+    if(m_impl && m_impl->connection){ m_impl->connection->close(); }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WebSocket::send_text(std::string_view text)
+{
+    if(!is_open()){ return; }
+    m_impl->send(opcode_t::TEXT, to_bytes(text));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WebSocket::send_binary(std::vector<uint8_t> data)
+{
+    if(!is_open()){ return; }
+    m_impl->send(opcode_t::BINARY, std::move(data));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WebSocket::ping(std::string_view payload)
+{
+    if(!is_open()){ return; }
+    m_impl->send(opcode_t::PING, to_bytes(payload.substr(0, 125)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WebSocket::close(uint16_t code, std::string_view reason)
+{
+    auto state = WebSocketImpl::state_t::CONNECTING;
+
+    if(m_impl->state.compare_exchange_strong(state, WebSocketImpl::state_t::CLOSED))
+    {
+        m_impl->connection->close();
+        return;
+    }
+
+    // the io-thread might have started closing meanwhile
+    if(state != WebSocketImpl::state_t::OPEN || m_impl->close_sent.exchange(true)){ return; }
+    state = WebSocketImpl::state_t::OPEN;
+    m_impl->state.compare_exchange_strong(state, WebSocketImpl::state_t::CLOSING);
+
+    // the connection is closed, once the peer echoed the close-frame or the close-timeout expired
+    auto payload = to_bytes(reason.substr(0, 123));
+    payload.insert(payload.begin(), {static_cast<uint8_t>(code >> 8), static_cast<uint8_t>(code)});
+    m_impl->send(opcode_t::CLOSE, std::move(payload));
+    m_impl->close_timer.expires_from_now(m_impl->close_timeout);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool WebSocket::is_open() const
+{
+    return m_impl && m_impl->state == WebSocketImpl::state_t::OPEN;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WebSocket::set_open_cb(open_cb_t cb)
+{
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    m_impl->open_cb = std::move(cb);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WebSocket::set_message_cb(message_cb_t cb)
+{
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    m_impl->message_cb = std::move(cb);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WebSocket::set_pong_cb(pong_cb_t cb)
+{
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    m_impl->pong_cb = std::move(cb);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WebSocket::set_close_cb(close_cb_t cb)
+{
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    m_impl->close_cb = std::move(cb);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t WebSocket::max_message_size() const
+{
+    return m_impl->max_message_size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WebSocket::set_max_message_size(size_t num_bytes)
+{
+    m_impl->max_message_size = num_bytes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+double WebSocket::close_timeout() const
+{
+    return m_impl->close_timeout;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WebSocket::set_close_timeout(double secs)
+{
+    m_impl->close_timeout = secs;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t WebSocket::max_frame_size() const
+{
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    return m_impl->max_frame_size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void WebSocket::set_max_frame_size(size_t num_bytes)
+{
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    m_impl->max_frame_size = num_bytes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+const std::string &WebSocket::path() const
+{
+    return m_impl->path;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+stats_t WebSocket::stats() const
+{
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    return m_impl->stats;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+tcp_connection_ptr WebSocket::connection() const
+{
+    return m_impl->connection;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct ServerImpl : public std::enable_shared_from_this<ServerImpl>
+{
+    io_service_t &io_service;
+    tcp_server server;
+    Server::connection_cb_t connection_cb;
+
+    // connections, pending a handshake or open
+    std::map<tcp_connection *, WebSocketPtr> connections;
+    mutable std::mutex mutex;
+
+    explicit ServerImpl(io_service_t &io_service) : io_service(io_service), server(io_service){}
+
+    void on_connect(const tcp_connection_ptr &connection)
+    {
+        auto ws = WebSocketPtr(new WebSocket());
+        auto impl = std::make_shared<WebSocketImpl>();
+        ws->m_impl = impl;
+        impl->connection = connection;
+
+        std::weak_ptr<ServerImpl> weak_self = shared_from_this();
+        auto *key = connection.get();
+
+        impl->open_cb = [weak_self](const WebSocketPtr &ws)
+        {
+            auto self = weak_self.lock();
+            if(!self){ return; }
+            Server::connection_cb_t cb;
+            {
+                std::unique_lock<std::mutex> lock(self->mutex);
+                cb = self->connection_cb;
+            }
+            if(cb){ cb(ws); }
+        };
+        impl->disconnect_hook = [weak_self, key]
+        {
+            auto self = weak_self.lock();
+            if(!self){ return; }
+            std::unique_lock<std::mutex> lock(self->mutex);
+            self->connections.erase(key);
+        };
+        attach(io_service, ws, impl);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        connections[key] = std::move(ws);
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+Server::Server(io_service_t &io_service, connection_cb_t cb) :
+        m_impl(std::make_shared<ServerImpl>(io_service))
+{
+    m_impl->connection_cb = std::move(cb);
+    std::weak_ptr<ServerImpl> weak_impl = m_impl;
+
+    m_impl->server.set_connection_callback([weak_impl](const tcp_connection_ptr &connection)
+                                           {
+                                               if(auto impl = weak_impl.lock()){ impl->on_connect(connection); }
+                                           });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Server::Server() = default;
+
+///////////////////////////////////////////////////////////////////////////////
+
+Server::~Server() = default;
+
+///////////////////////////////////////////////////////////////////////////////
+
+Server::Server(Server &&other) noexcept
+{
+    std::swap(m_impl, other.m_impl);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Server &Server::operator=(Server other)
+{
+    std::swap(m_impl, other.m_impl);
+    return *this;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Server::start_listen(uint16_t port)
+{
+    return m_impl && m_impl->server.start_listen(port);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Server::stop_listen()
+{
+    if(m_impl){ m_impl->server.stop_listen(); }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+uint16_t Server::listening_port() const
+{
+    return m_impl ? m_impl->server.listening_port() : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Server::set_connection_cb(connection_cb_t cb)
+{
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    m_impl->connection_cb = std::move(cb);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::vector<WebSocketPtr> Server::connections() const
+{
+    std::vector<WebSocketPtr> ret;
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+
+    for(const auto &[key, ws]: m_impl->connections)
+    {
+        if(ws->is_open()){ ret.push_back(ws); }
+    }
+    return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Server::broadcast(std::string_view text)
+{
+    for(const auto &ws: connections()){ ws->send_text(text); }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+}// namespace
@@ -0,0 +1,199 @@
+//  http_loopback.cpp
+//
+//  runs http::Server on an ephemeral port and drives it with http::Client:
+//  routing, keep-alive, 'Expect: 100-continue' and the limit for request-bodies.
+//  pipelining is checked with a raw socket, since libcurl no longer pipelines requests.
+//  usage: http_loopback
+
+#include <utility>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <string>
+#include <thread>
+#include <boost/asio.hpp>
+#include "netzer/http.hpp"
+#include "netzer/http_server.hpp"
+
+using namespace netzer;
+using duration_t = std::chrono::duration<double>;
+
+static bool g_success = true;
+
+static void check(bool condition, const char *description)
+{
+    printf("%-56s %s\n", description, condition ? "ok" : "FAILED");
+    g_success = g_success && condition;
+}
+
+static std::vector<uint8_t> to_bytes(const std::string &str)
+{
+    return {str.begin(), str.end()};
+}
+
+static std::string to_string(const std::vector<uint8_t> &bytes)
+{
+    return {bytes.begin(), bytes.end()};
+}
+
+/*!
+ * issue a request and wait for its response, failed requests yield status_code 0
+ */
+static http::response_t fetch(http::Client &client, const http::request_t &request)
+{
+    auto promise = std::make_shared<std::promise<http::response_t>>();
+    auto future = promise->get_future();
+
+    client.async_request(request,
+                         [promise](http::response_t &response){ promise->set_value(response); },
+                         {},
+                         [promise](const http::connection_info_t &, const std::string &)
+                         {
+                             promise->set_value({});
+                         });
+    if(future.wait_for(std::chrono::seconds(10)) != std::future_status::ready){ return {}; }
+    return future.get();
+}
+
+static http::request_t make_request(http::method_t method, const std::string &url, std::vector<uint8_t> data = {})
+{
+    http::request_t ret;
+    ret.method = method;
+    ret.url = url;
+    ret.data = std::move(data);
+    ret.mime_type = "text/plain";
+    return ret;
+}
+
+/*!
+ * send all requests with a single write over a raw socket, return everything received until the server closes
+ */
+static std::string send_raw(uint16_t port, const std::string &requests)
+{
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::socket socket(io);
+    boost::system::error_code ec;
+    socket.connect({boost::asio::ip::make_address("127.0.0.1"), port}, ec);
+    if(ec){ return {}; }
+    boost::asio::write(socket, boost::asio::buffer(requests), ec);
+
+    std::string ret;
+    char buf[4096];
+
+    for(;;)
+    {
+        size_t n = socket.read_some(boost::asio::buffer(buf), ec);
+        ret.append(buf, n);
+        if(ec){ break; }
+    }
+    return ret;
+}
+
+static size_t count(const std::string &str, const std::string &pattern)
+{
+    size_t ret = 0;
+    for(auto pos = str.find(pattern); pos != std::string::npos; pos = str.find(pattern, pos + 1)){ ++ret; }
+    return ret;
+}
+
+int main()
+{
+    io_service_t io;
+    auto work = boost::asio::make_work_guard(io);
+    std::thread io_thread([&io]{ io.run(); });
+
+    http::Server server(io);
+
+    server.add_route("GET", "/hello", [](const http::server_request_t &, http::server_response_t &response)
+    {
+        response.body = to_bytes("hello");
+    });
+    server.add_route("GET", "/files/*", [](const http::server_request_t &request, http::server_response_t &response)
+    {
+        response.body = to_bytes("file:" + std::string(request.path));
+    });
+    server.add_route("GET", "/files/special", [](const http::server_request_t &, http::server_response_t &response)
+    {
+        response.body = to_bytes("special");
+    });
+    std::string expect;
+    server.add_route("POST", "/echo", [&expect](const http::server_request_t &request, http::server_response_t &response)
+    {
+        expect = request.header("expect");
+        response.body.assign(request.body.begin(), request.body.end());
+    });
+
+    if(!server.start_listen(0))
+    {
+        check(false, "start_listen on an ephemeral port");
+        return EXIT_FAILURE;
+    }
+    uint16_t port = server.listening_port();
+    std::string base_url = "http://127.0.0.1:" + std::to_string(port);
+
+    http::Client client;
+    client.start_io_thread();
+
+    // routing
+    auto response = fetch(client, make_request(http::method_t::GET, base_url + "/hello"));
+    check(response.status_code == 200 && to_string(response.data) == "hello", "exact route");
+
+    response = fetch(client, make_request(http::method_t::GET, base_url + "/files/a/b"));
+    check(response.status_code == 200 && to_string(response.data) == "file:/files/a/b", "prefix route");
+
+    response = fetch(client, make_request(http::method_t::GET, base_url + "/files/special"));
+    check(response.status_code == 200 && to_string(response.data) == "special", "exact route before prefix route");
+
+    response = fetch(client, make_request(http::method_t::PUT, base_url + "/hello", to_bytes("x")));
+    check(response.status_code == 404, "method mismatch yields 404");
+
+    response = fetch(client, make_request(http::method_t::GET, base_url + "/missing"));
+    check(response.status_code == 404, "unknown path yields 404");
+
+    // keep-alive: subsequent requests reuse the connection
+    auto num_connections = server.stats().num_connections;
+    bool reused = true;
+
+    for(int i = 0; i < 5; ++i)
+    {
+        response = fetch(client, make_request(http::method_t::GET, base_url + "/hello"));
+        reused = reused && response.status_code == 200 && response.timing.connection_reused;
+    }
+    check(reused && server.stats().num_connections == num_connections, "keep-alive reuses the connection");
+
+    // pipelining: three requests in a single write, answered in order
+    std::string pipelined = "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                            "GET /files/x HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                            "GET /hello HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+    auto raw = send_raw(port, pipelined);
+    auto first = raw.find("hello"), second = raw.find("file:/files/x"), third = raw.rfind("hello");
+    check(count(raw, "HTTP/1.1 200") == 3 && first < second && second < third && third != std::string::npos,
+          "pipelined requests are answered in order");
+
+    // libcurl sends 'Expect: 100-continue' for large bodies and waits up to 1s for the interim response
+    std::vector<uint8_t> large_body(2 << 20);
+    for(size_t i = 0; i < large_body.size(); ++i){ large_body[i] = static_cast<uint8_t>(i); }
+    auto start = std::chrono::steady_clock::now();
+    response = fetch(client, make_request(http::method_t::POST, base_url + "/echo", large_body));
+    double secs = duration_t(std::chrono::steady_clock::now() - start).count();
+    check(response.status_code == 200 && response.data == large_body, "POST with large body is echoed");
+    check(expect == "100-continue" && secs < 0.9, "100-continue is answered without delay");
+
+    // request-bodies exceeding the limit
+    server.set_max_body_size(1024);
+    response = fetch(client, make_request(http::method_t::POST, base_url + "/echo", std::vector<uint8_t>(4096)));
+    check(response.status_code == 413, "oversized body yields 413");
+
+    response = fetch(client, make_request(http::method_t::POST, base_url + "/echo", large_body));
+    check(response.status_code == 413, "oversized body with 100-continue yields 413");
+
+    response = fetch(client, make_request(http::method_t::POST, base_url + "/echo", to_bytes("small")));
+    check(response.status_code == 200 && to_string(response.data) == "small", "server recovers after 413");
+
+    client.stop_io_thread();
+    server.stop_listen();
+    work.reset();
+    io.stop();
+    io_thread.join();
+    return g_success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
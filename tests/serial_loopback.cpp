@@ -0,0 +1,310 @@
+//  serial_loopback.cpp
+//
+//  drives Serial through a pseudo-terminal pair, with a forked echo-peer on the master side.
+//  the peer emulates the line-rate for a baud-rate (8N1), 0 means unpaced.
+//  reports throughput, cpu-time per byte and round-trip latencies, using receive-callbacks or read_bytes.
+//  read_bytes-mode polls the Serial, so its cpu-time includes spinning while waiting for data.
+//  usage: serial_loopback [--test] [seconds per run]
+
+#include <utility>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <boost/asio.hpp>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <util.h>
+#else
+#include <pty.h>
+#endif
+
+#include "netzer/Serial.hpp"
+#include "netzer/histogram.hpp"
+
+using namespace std::chrono;
+using duration_t = std::chrono::duration<double>;
+
+enum class receive_mode_t{ CALLBACK, READ_BYTES };
+
+struct config_t
+{
+    int baud_rate = 0;
+    size_t message_size = 64;
+    receive_mode_t mode = receive_mode_t::CALLBACK;
+
+    // limits for each phase
+    double seconds = 0.5;
+    size_t max_bytes = 8 << 20, max_round_trips = 2000;
+};
+
+struct result_t
+{
+    bool ok = false;
+    size_t num_bytes = 0;
+    double throughput = 0.0, cpu_per_byte = 0.0;
+    crocore::histogram_t round_trips;
+};
+
+//! a pty-pair, with a forked process echoing everything written to the slave
+struct loopback_t
+{
+    std::string device;
+    pid_t peer = -1;
+
+    explicit loopback_t(int baud_rate)
+    {
+        int master = -1, slave = -1;
+        char name[256] = {};
+        termios tio = {};
+        cfmakeraw(&tio);
+        if(openpty(&master, &slave, name, &tio, nullptr)){ return; }
+        device = name;
+
+        peer = fork();
+
+        if(!peer)
+        {
+            close(slave);
+            echo(master, baud_rate);
+            _exit(0);
+        }
+        close(master);
+
+        // keep the slave open until Serial has opened it, so the peer does not see a hangup
+        slave_fd = slave;
+    }
+
+    ~loopback_t()
+    {
+        if(slave_fd >= 0){ close(slave_fd); }
+        if(peer > 0)
+        {
+            kill(peer, SIGTERM);
+            waitpid(peer, nullptr, 0);
+        }
+    }
+
+    int slave_fd = -1;
+
+    static void echo(int fd, int baud_rate)
+    {
+        std::vector<uint8_t> buf(4096);
+        auto next = steady_clock::now();
+
+        for(;;)
+        {
+            ssize_t n = read(fd, buf.data(), buf.size());
+            if(n < 0 && errno == EINTR){ continue; }
+            if(n <= 0){ return; }
+
+            // bytes leave at line-rate, 10 bits per byte
+            if(baud_rate)
+            {
+                next = std::max(next, steady_clock::now()) +
+                       duration_cast<steady_clock::duration>(duration_t(10.0 * n / baud_rate));
+                std::this_thread::sleep_until(next);
+            }
+
+            for(ssize_t off = 0; off < n;)
+            {
+                ssize_t w = write(fd, buf.data() + off, n - off);
+                if(w < 0 && errno == EINTR){ continue; }
+                if(w <= 0){ return; }
+                off += w;
+            }
+        }
+    }
+};
+
+static double cpu_seconds()
+{
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + 1e-6 * (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+//! receiving side, verifying a stream of bytes with values (index & 0xff)
+struct receiver_t
+{
+    std::mutex mutex;
+    std::condition_variable cond;
+    size_t num_bytes = 0;
+    bool ok = true;
+
+    void consume(const uint8_t *data, size_t n)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for(size_t i = 0; i < n; ++i){ ok = ok && data[i] == static_cast<uint8_t>(num_bytes + i); }
+        num_bytes += n;
+        cond.notify_all();
+    }
+};
+
+/*!
+ * wait until the receiver got num_bytes in total (callback-mode) or read them (read_bytes-mode)
+ */
+static bool wait_for(const netzer::SerialPtr &serial, receiver_t &receiver, receive_mode_t mode, size_t num_bytes,
+                     steady_clock::time_point deadline)
+{
+    if(mode == receive_mode_t::CALLBACK)
+    {
+        std::unique_lock<std::mutex> lock(receiver.mutex);
+        return receiver.cond.wait_until(lock, deadline, [&]{ return receiver.num_bytes >= num_bytes; });
+    }
+    std::vector<uint8_t> buf(4096);
+
+    while(receiver.num_bytes < num_bytes)
+    {
+        if(steady_clock::now() > deadline){ return false; }
+        size_t n = serial->read_bytes(buf.data(), std::min(buf.size(), num_bytes - receiver.num_bytes));
+        if(n){ receiver.consume(buf.data(), n); }
+        else{ std::this_thread::yield(); }
+    }
+    return true;
+}
+
+static std::vector<uint8_t> message(size_t offset, size_t size)
+{
+    std::vector<uint8_t> ret(size);
+    for(size_t i = 0; i < size; ++i){ ret[i] = static_cast<uint8_t>(offset + i); }
+    return ret;
+}
+
+static result_t run(const config_t &cfg)
+{
+    result_t ret;
+    loopback_t loopback(cfg.baud_rate);
+    if(loopback.device.empty() || loopback.peer < 0){ return ret; }
+
+    netzer::io_service_t io;
+    auto work = boost::asio::make_work_guard(io);
+    std::thread io_thread([&io]{ io.run(); });
+
+    receiver_t receiver;
+    auto serial = netzer::Serial::create(io);
+
+    if(cfg.mode == receive_mode_t::CALLBACK)
+    {
+        serial->set_receive_cb([&receiver](netzer::ConnectionPtr, const std::vector<uint8_t> &data)
+                               {
+                                   receiver.consume(data.data(), data.size());
+                               });
+    }
+    else{ serial->set_overflow_policy(netzer::overflow_policy_t::PAUSE); }
+
+    // at least 10 round-trips, even for slow lines
+    double line_rate = cfg.baud_rate ? cfg.baud_rate / 10.0 : 0.0;
+    double timeout = 10.0 + (line_rate ? 20.0 * cfg.message_size / line_rate : 0.0);
+
+    if(serial->open(loopback.device, cfg.baud_rate ? cfg.baud_rate : 115200))
+    {
+        close(loopback.slave_fd);
+        loopback.slave_fd = -1;
+        ret.ok = true;
+        size_t offset = 0;
+
+        // throughput, keeping at most 64kB in flight
+        size_t total = std::max(cfg.message_size, cfg.max_bytes);
+        if(line_rate){ total = std::min(total, std::max(cfg.message_size, size_t(line_rate * cfg.seconds))); }
+        total -= total % cfg.message_size;
+
+        double cpu_start = cpu_seconds();
+        auto start = steady_clock::now();
+        auto deadline = start + duration_cast<steady_clock::duration>(duration_t(timeout + cfg.seconds * 4));
+
+        for(; offset < total && ret.ok; offset += cfg.message_size)
+        {
+            serial->write_bytes(message(offset, cfg.message_size).data(), cfg.message_size);
+            size_t in_flight = (1 << 16);
+            if(offset + cfg.message_size > in_flight)
+            {
+                ret.ok = wait_for(serial, receiver, cfg.mode, offset + cfg.message_size - in_flight, deadline);
+            }
+        }
+        ret.ok = ret.ok && wait_for(serial, receiver, cfg.mode, offset, deadline);
+
+        double secs = duration_t(steady_clock::now() - start).count();
+        ret.num_bytes = offset;
+        ret.throughput = offset / secs;
+        ret.cpu_per_byte = (cpu_seconds() - cpu_start) / static_cast<double>(offset ? offset : 1);
+
+        // round-trips
+        start = steady_clock::now();
+
+        for(size_t i = 0; i < cfg.max_round_trips && ret.ok; ++i)
+        {
+            if(i >= 10 && duration_t(steady_clock::now() - start).count() > cfg.seconds){ break; }
+            crocore::ScopedTimer t(ret.round_trips);
+            serial->write_bytes(message(offset, cfg.message_size).data(), cfg.message_size);
+            offset += cfg.message_size;
+            ret.ok = wait_for(serial, receiver, cfg.mode, offset,
+                              steady_clock::now() + duration_cast<steady_clock::duration>(duration_t(timeout)));
+        }
+        std::unique_lock<std::mutex> lock(receiver.mutex);
+        ret.ok = ret.ok && receiver.ok;
+    }
+    serial->close();
+    work.reset();
+    io.stop();
+    io_thread.join();
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    bool test = argc > 1 && !strcmp(argv[1], "--test");
+    double seconds = argc > 1 + test ? std::strtod(argv[1 + test], nullptr) : 0.5;
+
+    std::vector<int> baud_rates = {115200, 921600, 0};
+    std::vector<size_t> message_sizes = {8, 64, 512, 4096};
+
+    // quick integrity-check
+    if(test)
+    {
+        baud_rates = {921600, 0};
+        message_sizes = {1, 64, 4096};
+        seconds = 0.1;
+    }
+    bool success = true;
+
+    printf("%-8s %6s %-10s %10s %10s %9s %9s %9s %9s\n", "baud", "bytes", "mode",
+           "MB/s", "cpu ns/B", "rtt p50", "p99", "p99.9", "(us)");
+
+    for(int baud_rate: baud_rates)
+    {
+        for(size_t message_size: message_sizes)
+        {
+            for(auto mode: {receive_mode_t::CALLBACK, receive_mode_t::READ_BYTES})
+            {
+                config_t cfg;
+                cfg.baud_rate = baud_rate;
+                cfg.message_size = message_size;
+                cfg.mode = mode;
+                cfg.seconds = seconds;
+                if(test){ cfg.max_bytes = 1 << 20; cfg.max_round_trips = 100; }
+
+                auto r = run(cfg);
+                success = success && r.ok;
+
+                printf("%-8s %6zu %-10s %10.2f %10.1f %9.1f %9.1f %9.1f %s\n",
+                       baud_rate ? std::to_string(baud_rate).c_str() : "unpaced", message_size,
+                       mode == receive_mode_t::CALLBACK ? "callback" : "read_bytes",
+                       r.throughput / 1e6, r.cpu_per_byte * 1e9,
+                       r.round_trips.percentile(0.5) * 1e6, r.round_trips.percentile(0.99) * 1e6,
+                       r.round_trips.percentile(0.999) * 1e6, r.ok ? "" : "FAILED");
+            }
+        }
+    }
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,95 @@
+//  timer_benchmark.cpp
+//
+//  compares Timers backed by a TimerService (timing-wheel) with Timers using dedicated asio-timers.
+//  usage: timer_benchmark [num_timers]
+
+#include <utility>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <boost/asio.hpp>
+#include "netzer/Timer.hpp"
+
+using duration_t = std::chrono::duration<double>;
+
+struct result_t
+{
+    double create = 0.0, arm = 0.0, rearm = 0.0, cancel = 0.0, run = 0.0;
+    size_t num_fired = 0;
+};
+
+template<typename F>
+static double measure(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return duration_t(std::chrono::steady_clock::now() - start).count();
+}
+
+template<typename Factory>
+static result_t run_benchmark(crocore::io_service_t &io, size_t num_timers, Factory factory)
+{
+    result_t ret;
+    std::vector<crocore::Timer> timers;
+    std::vector<double> delays(num_timers);
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<double> dist(0.1, 1.0);
+    for(auto &d: delays){ d = dist(rng); }
+
+    ret.create = measure([&]
+                         {
+                             timers.reserve(num_timers);
+                             for(size_t i = 0; i < num_timers; ++i)
+                             {
+                                 timers.push_back(factory([&ret]{ ret.num_fired++; }));
+                             }
+                         });
+    ret.arm = measure([&]{ for(size_t i = 0; i < num_timers; ++i){ timers[i].expires_from_now(delays[i]); }});
+
+    // re-arm in reverse order
+    ret.rearm = measure([&]{ for(size_t i = num_timers; i-- > 0;){ timers[i].expires_from_now(delays[i]); }});
+
+    // cancel every other timer
+    ret.cancel = measure([&]{ for(size_t i = 0; i < num_timers; i += 2){ timers[i].cancel(); }});
+
+    ret.run = measure([&]
+                      {
+                          io.restart();
+                          io.run();
+                      });
+    return ret;
+}
+
+static void print(const char *name, const result_t &r, size_t num_timers)
+{
+    auto ns = [num_timers](double secs, size_t n){ return 1e9 * secs / static_cast<double>(n ? n : num_timers); };
+    printf("%-14s create: %7.1f ns  arm: %7.1f ns  re-arm: %7.1f ns  cancel: %7.1f ns  "
+           "run: %.3f s (%zu fired)\n", name, ns(r.create, num_timers), ns(r.arm, num_timers),
+           ns(r.rearm, num_timers), ns(r.cancel, num_timers / 2), r.run, r.num_fired);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t num_timers = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    printf("%zu timers, expiring within 0.1 - 1.0 s\n", num_timers);
+
+    {
+        crocore::io_service_t io;
+        crocore::TimerService service(io);
+        auto r = run_benchmark(io, num_timers, [&service](crocore::Timer::timer_cb_t cb)
+        {
+            return crocore::Timer(service, std::move(cb));
+        });
+        print("timing-wheel", r, num_timers);
+    }
+
+    {
+        crocore::io_service_t io;
+        auto r = run_benchmark(io, num_timers, [&io](crocore::Timer::timer_cb_t cb)
+        {
+            return crocore::Timer(io, std::move(cb));
+        });
+        print("asio-timers", r, num_timers);
+    }
+    return 0;
+}
@@ -0,0 +1,268 @@
+//  websocket_loopback.cpp
+//
+//  runs websocket::Server on an ephemeral port and connects WebSocket-clients to it:
+//  handshake, echo of text- and binary-messages, fragmentation, ping/pong,
+//  closing-handshake, close-timeout and failing connections (message too big, invalid UTF-8,
+//  invalid close-frames).
+//  usage: websocket_loopback
+
+#include <utility>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <boost/asio.hpp>
+#include "netzer/websocket.hpp"
+
+using namespace netzer;
+
+static bool g_success = true;
+
+static void check(bool condition, const char *description)
+{
+    printf("%-56s %s\n", description, condition ? "ok" : "FAILED");
+    g_success = g_success && condition;
+}
+
+//! events observed by callbacks on the io-thread
+struct events_t
+{
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    bool open = false;
+    std::vector<std::pair<websocket::opcode_t, std::vector<uint8_t>>> messages;
+    std::vector<std::string> pongs;
+
+    // close-codes (0: not closed yet) and reason received by the server
+    uint16_t client_close_code = 0, server_close_code = 0;
+    std::string server_close_reason;
+
+    // server-side of the most recent connection
+    websocket::WebSocketPtr server_side;
+
+    template<typename Predicate>
+    bool wait(Predicate predicate)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cond.wait_for(lock, std::chrono::seconds(5), [&]{ return predicate(); });
+    }
+
+    template<typename F>
+    void update(F f)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        f();
+        cond.notify_all();
+    }
+};
+
+/*!
+ * connect a client recording all events, return after a successful handshake (or an empty pointer)
+ */
+static websocket::WebSocketPtr connect(io_service_t &io, uint16_t port, events_t &events)
+{
+    auto ws = websocket::WebSocket::connect(io, "ws://127.0.0.1:" + std::to_string(port) + "/echo",
+                                            [&events](const websocket::WebSocketPtr &)
+                                            {
+                                                events.update([&]{ events.open = true; });
+                                            });
+    if(!ws){ return {}; }
+
+    ws->set_message_cb([&events](const websocket::WebSocketPtr &, const websocket::message_t &msg)
+                       {
+                           events.update([&]{ events.messages.emplace_back(msg.opcode, std::vector<uint8_t>(msg.data, msg.data + msg.size)); });
+                       });
+    ws->set_pong_cb([&events](const websocket::WebSocketPtr &, std::string_view payload)
+                    {
+                        events.update([&]{ events.pongs.emplace_back(payload); });
+                    });
+    ws->set_close_cb([&events](const websocket::WebSocketPtr &, uint16_t code, std::string_view)
+                     {
+                         events.update([&]{ events.client_close_code = code; });
+                     });
+    if(!events.wait([&]{ return events.open && events.server_side; })){ return {}; }
+    return ws;
+}
+
+int main()
+{
+    io_service_t io;
+    auto work = boost::asio::make_work_guard(io);
+    std::thread io_thread([&io]{ io.run(); });
+
+    // limit for incoming messages on the server-side
+    constexpr size_t max_message_size = 64 * (1 << 10);
+
+    events_t *current = nullptr;
+    std::mutex current_mutex;
+
+    // the server echoes all messages
+    websocket::Server server(io, [&](const websocket::WebSocketPtr &ws)
+    {
+        std::unique_lock<std::mutex> lock(current_mutex);
+        auto *events = current;
+
+        ws->set_max_message_size(max_message_size);
+        ws->set_message_cb([](const websocket::WebSocketPtr &ws, const websocket::message_t &msg)
+                           {
+                               if(msg.opcode == websocket::opcode_t::TEXT){ ws->send_text(msg.text()); }
+                               else{ ws->send_binary({msg.data, msg.data + msg.size}); }
+                           });
+        ws->set_close_cb([events](const websocket::WebSocketPtr &, uint16_t code, std::string_view reason)
+                         {
+                             events->update([&]
+                                            {
+                                                events->server_close_code = code;
+                                                events->server_close_reason = reason;
+                                            });
+                         });
+        events->update([&]{ events->server_side = ws; });
+    });
+
+    if(!server.start_listen(0))
+    {
+        check(false, "start_listen on an ephemeral port");
+        return EXIT_FAILURE;
+    }
+    uint16_t port = server.listening_port();
+
+    auto new_session = [&](events_t &events)
+    {
+        std::unique_lock<std::mutex> lock(current_mutex);
+        current = &events;
+    };
+
+    // handshake and echo
+    {
+        events_t events;
+        new_session(events);
+        auto ws = connect(io, port, events);
+        check(ws && ws->is_open() && events.server_side->path() == "/echo", "handshake");
+        if(!ws){ return EXIT_FAILURE; }
+
+        ws->send_text("hello websocket");
+        std::vector<uint8_t> binary(1000);
+        for(size_t i = 0; i < binary.size(); ++i){ binary[i] = static_cast<uint8_t>(i); }
+        ws->send_binary(binary);
+
+        check(events.wait([&]{ return events.messages.size() == 2; }) &&
+              events.messages[0].first == websocket::opcode_t::TEXT &&
+              std::string(events.messages[0].second.begin(), events.messages[0].second.end()) == "hello websocket",
+              "text echo");
+        check(events.messages.size() == 2 && events.messages[1].first == websocket::opcode_t::BINARY &&
+              events.messages[1].second == binary, "binary echo");
+
+        // fragmented message, reassembled by the server
+        auto num_frames = events.server_side->stats().num_frames_received;
+        ws->set_max_frame_size(1000);
+        std::vector<uint8_t> large(10000);
+        for(size_t i = 0; i < large.size(); ++i){ large[i] = static_cast<uint8_t>(i * 7); }
+        ws->send_binary(large);
+
+        check(events.wait([&]{ return events.messages.size() == 3; }) && events.messages[2].second == large &&
+              events.server_side->stats().num_frames_received - num_frames == 10, "fragmented message");
+
+        // ping/pong
+        ws->ping("ping-payload");
+        check(events.wait([&]{ return !events.pongs.empty(); }) && events.pongs.front() == "ping-payload",
+              "ping/pong");
+
+        // closing-handshake, initiated by the client
+        ws->close(websocket::CLOSE_NORMAL, "bye");
+        check(events.wait([&]{ return events.client_close_code && events.server_close_code; }) &&
+              events.server_close_code == websocket::CLOSE_NORMAL && events.server_close_reason == "bye" &&
+              events.client_close_code == websocket::CLOSE_NORMAL && !ws->is_open(), "closing-handshake");
+    }
+
+    // messages exceeding the server's limit
+    {
+        events_t events;
+        new_session(events);
+        auto ws = connect(io, port, events);
+        if(ws){ ws->send_binary(std::vector<uint8_t>(max_message_size + 1)); }
+        check(ws && events.wait([&]{ return events.client_close_code; }) &&
+              events.client_close_code == websocket::CLOSE_MESSAGE_TOO_BIG, "message too big");
+    }
+
+    // fragmented messages exceeding the server's limit
+    {
+        events_t events;
+        new_session(events);
+        auto ws = connect(io, port, events);
+        if(ws)
+        {
+            ws->set_max_frame_size(max_message_size / 4);
+            ws->send_binary(std::vector<uint8_t>(max_message_size * 2));
+        }
+        check(ws && events.wait([&]{ return events.client_close_code; }) &&
+              events.client_close_code == websocket::CLOSE_MESSAGE_TOO_BIG, "fragmented message too big");
+    }
+
+    // text-messages need to be valid UTF-8
+    {
+        events_t events;
+        new_session(events);
+        auto ws = connect(io, port, events);
+        if(ws){ ws->send_text("invalid \xC3\x28 utf-8"); }
+        check(ws && events.wait([&]{ return events.client_close_code; }) &&
+              events.client_close_code == websocket::CLOSE_INVALID_PAYLOAD && events.messages.empty(),
+              "invalid UTF-8");
+    }
+
+    // close-frames with reserved status-codes or invalid reasons are protocol-errors
+    for(auto [code, reason, description]: {std::make_tuple(uint16_t(websocket::CLOSE_NO_STATUS), "", "reserved close-code"),
+                                           std::make_tuple(uint16_t(999), "", "close-code below 1000"),
+                                           std::make_tuple(uint16_t(websocket::CLOSE_NORMAL), "\xC3\x28",
+                                                           "close-reason with invalid UTF-8")})
+    {
+        events_t events;
+        new_session(events);
+        auto ws = connect(io, port, events);
+        if(ws){ ws->close(code, reason); }
+        check(ws && events.wait([&]{ return events.client_close_code && events.server_close_code; }) &&
+              events.server_close_code == websocket::CLOSE_PROTOCOL_ERROR &&
+              events.client_close_code == websocket::CLOSE_PROTOCOL_ERROR, description);
+    }
+
+    // a peer not answering the closing-handshake is dropped after the close-timeout
+    {
+        events_t events;
+        new_session(events);
+        boost::asio::io_context raw_io;
+        boost::asio::ip::tcp::socket socket(raw_io);
+        boost::system::error_code ec;
+        socket.connect({boost::asio::ip::make_address("127.0.0.1"), port}, ec);
+        std::string request = "GET /silent HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\n"
+                              "Connection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                              "Sec-WebSocket-Version: 13\r\n\r\n";
+        boost::asio::write(socket, boost::asio::buffer(request), ec);
+
+        bool open = !ec && events.wait([&]{ return events.server_side != nullptr; });
+        auto start = std::chrono::steady_clock::now();
+
+        if(open)
+        {
+            events.server_side->set_close_timeout(0.2);
+            events.server_side->close(websocket::CLOSE_GOING_AWAY);
+        }
+
+        // read the handshake-response and close-frame, without answering
+        char buf[4096];
+        while(!ec){ socket.read_some(boost::asio::buffer(buf), ec); }
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        check(open && ec == boost::asio::error::eof && secs >= 0.15 &&
+              events.wait([&]{ return events.server_close_code; }) &&
+              events.server_close_code == websocket::CLOSE_ABNORMAL, "close-timeout drops a silent peer");
+    }
+
+    server.stop_listen();
+    work.reset();
+    io.stop();
+    io_thread.join();
+    return g_success ? EXIT_SUCCESS : EXIT_FAILURE;
+}